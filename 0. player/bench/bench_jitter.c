@@ -0,0 +1,357 @@
+/*
+ * bench_jitter - playback loop wakeup latency under controlled interference
+ *
+ * Runs a QUA_STATS player build (null sink, or any device such as the
+ * snd-aloop Loopback card) pinned to the audio core at SCHED_FIFO 99, once
+ * per interference mix, and tabulates the per-period wakeup latency the
+ * player writes to /tmp/qua-stats.txt (interrupt or timer expiry -> return
+ * from poll): p50/p99/p99.99/max.
+ *
+ * Interference, relative to the audio core:
+ *   membw     memcpy streams on the other cores of its L3 (CCD/CCX)
+ *   smt       ALU + L2 load on its SMT sibling(s)
+ *   irq       20 us hrtimer storm and a UDP loopback flood (softirq) on it
+ *   pagecache file write/fsync/drop/read churn on another core
+ *   all       everything at once
+ *
+ *   make null PLAYER_DEFS=-DQUA_STATS
+ *   sudo bin/bench-jitter bin/qua-player-32-48000-null [core] [seconds] [device]
+ */
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STATS_PATH	"/tmp/qua-stats.txt"
+#define CHURN_DIR	"/var/tmp"	/* a real filesystem, not tmpfs */
+#define MEMBW_BYTES	(64UL << 20)
+#define CHURN_BYTES	(256UL << 20)
+#define MAX_STRESS	256
+
+enum { MEMBW = 1, SMT = 2, IRQ = 4, PAGECACHE = 8 };
+
+static const struct {
+	const char *name;
+	int mask;
+} configs[] = {
+	{ "none", 0 },
+	{ "membw", MEMBW },
+	{ "smt", SMT },
+	{ "irq", IRQ },
+	{ "pagecache", PAGECACHE },
+	{ "all", MEMBW | SMT | IRQ | PAGECACHE },
+};
+
+static volatile int stop;
+static int audio_core;
+
+static int read_cpulist(const char *path, cpu_set_t *set)
+{
+	char list[512];
+	FILE *f = fopen(path, "r");
+
+	CPU_ZERO(set);
+	if (!f)
+		return -1;
+	if (!fgets(list, sizeof(list), f)) {
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+	for (char *p = list; *p && *p != '\n';) {
+		char *end;
+		long lo = strtol(p, &end, 10), hi = lo;
+		if (end == p)
+			break;
+		if (*end == '-')
+			hi = strtol(end + 1, &end, 10);
+		for (long c = lo; c <= hi && c < CPU_SETSIZE; c++)
+			CPU_SET(c, set);
+		p = *end == ',' ? end + 1 : end;
+	}
+	return 0;
+}
+
+static void pin(int cpu)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/* --- Stressors: each runs pinned until stop --- */
+
+static void *membw_worker(void *arg)
+{
+	pin((int)(intptr_t)arg);
+	char *a = malloc(MEMBW_BYTES), *b = malloc(MEMBW_BYTES);
+	if (a && b) {
+		memset(a, 1, MEMBW_BYTES);
+		while (!stop) {
+			memcpy(b, a, MEMBW_BYTES);
+			memcpy(a, b, MEMBW_BYTES);
+		}
+	}
+	free(a);
+	free(b);
+	return NULL;
+}
+
+static void *smt_worker(void *arg)
+{
+	pin((int)(intptr_t)arg);
+	static __thread uint64_t buf[1 << 17];	/* 1 MB: lives in L2 */
+	uint64_t x = 1;
+	while (!stop)
+		for (size_t i = 0; i < sizeof(buf) / sizeof(buf[0]); i += 8) {
+			x = x * 6364136223846793005ULL + buf[i];
+			buf[i] = x;
+		}
+	return NULL;
+}
+
+static void *timer_worker(void *arg)
+{
+	pin((int)(intptr_t)arg);
+	const struct timespec tick = { 0, 20000 };
+	while (!stop)
+		clock_nanosleep(CLOCK_MONOTONIC, 0, &tick, NULL);
+	return NULL;
+}
+
+/* Loopback UDP: the receive softirq runs on the sending CPU */
+static void *udp_worker(void *arg)
+{
+	pin((int)(intptr_t)arg);
+	int rx = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+	int tx = socket(AF_INET, SOCK_DGRAM, 0);
+	struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+	socklen_t len = sizeof(addr);
+	char msg[64] = { 0 }, drain[64];
+
+	if (rx < 0 || tx < 0 || bind(rx, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+	    getsockname(rx, (struct sockaddr *)&addr, &len) != 0)
+		return NULL;
+	while (!stop) {
+		for (int i = 0; i < 64; i++)
+			sendto(tx, msg, sizeof(msg), 0, (struct sockaddr *)&addr, sizeof(addr));
+		while (recv(rx, drain, sizeof(drain), 0) > 0)
+			;
+	}
+	close(rx);
+	close(tx);
+	return NULL;
+}
+
+static void *pagecache_worker(void *arg)
+{
+	pin((int)(intptr_t)arg);
+	char path[64];
+	snprintf(path, sizeof(path), CHURN_DIR "/bench-jitter-%d", getpid());
+	char *buf = calloc(1, 1 << 20);
+	while (buf && !stop) {
+		int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+		if (fd < 0)
+			break;
+		for (size_t done = 0; done < CHURN_BYTES && !stop; done += 1 << 20)
+			if (write(fd, buf, 1 << 20) < 0)
+				break;
+		fsync(fd);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		lseek(fd, 0, SEEK_SET);
+		while (!stop && read(fd, buf, 1 << 20) > 0)
+			;
+		close(fd);
+	}
+	unlink(path);
+	free(buf);
+	return NULL;
+}
+
+static pthread_t stressors[MAX_STRESS];
+static int nstressors;
+
+static void spawn(void *(*fn)(void *), int cpu)
+{
+	if (nstressors < MAX_STRESS &&
+	    pthread_create(&stressors[nstressors], NULL, fn, (void *)(intptr_t)cpu) == 0)
+		nstressors++;
+}
+
+static void start_stress(int mask)
+{
+	char path[128];
+	cpu_set_t l3, smt;
+	const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index3/shared_cpu_list", audio_core);
+	read_cpulist(path, &l3);
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", audio_core);
+	read_cpulist(path, &smt);
+	CPU_SET(audio_core, &smt);
+
+	stop = 0;
+	nstressors = 0;
+	int other = -1;	/* any core outside the audio core's SMT group */
+	for (long c = 0; c < cpus && c < CPU_SETSIZE; c++) {
+		if (CPU_ISSET(c, &smt)) {
+			if ((mask & SMT) && c != audio_core)
+				spawn(smt_worker, c);
+			continue;
+		}
+		if (other < 0)
+			other = c;
+		if ((mask & MEMBW) && CPU_ISSET(c, &l3))
+			spawn(membw_worker, c);
+	}
+	if (mask & IRQ) {
+		spawn(timer_worker, audio_core);
+		spawn(udp_worker, audio_core);
+	}
+	if ((mask & PAGECACHE) && other >= 0)
+		spawn(pagecache_worker, other);
+}
+
+static void stop_stress(void)
+{
+	stop = 1;
+	for (int i = 0; i < nstressors; i++)
+		pthread_join(stressors[i], NULL);
+}
+
+/* Player pinned to the audio core at SCHED_FIFO 99, as the launcher does */
+static int run_player(const char *player, const char *wav, const char *device)
+{
+	pid_t pid = fork();
+	if (pid == 0) {
+		cpu_set_t set;
+		struct sched_param sp = { .sched_priority = 99 };
+		CPU_ZERO(&set);
+		CPU_SET(audio_core, &set);
+		sched_setaffinity(0, sizeof(set), &set);
+		if (sched_setscheduler(0, SCHED_FIFO, &sp) != 0)
+			perror("SCHED_FIFO (results will not be representative)");
+		execl(player, player, wav, device, "0", "0", (char *)NULL);
+		_exit(127);
+	}
+	int status;
+	if (pid < 0 || waitpid(pid, &status, 0) != pid)
+		return -1;
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static double stat_value(const char *key)
+{
+	char line[128];
+	double v = -1;
+	const size_t n = strlen(key);
+	FILE *f = fopen(STATS_PATH, "r");
+
+	if (!f)
+		return -1;
+	while (fgets(line, sizeof(line), f))
+		if (strncmp(line, key, n) == 0 && line[n] == '=')
+			v = atof(line + n + 1);
+	fclose(f);
+	return v;
+}
+
+static int write_wav(const char *path, int bits, int rate, int seconds)
+{
+	const uint32_t data = (uint32_t)seconds * rate * 2 * (bits / 8);
+	const uint16_t fmt[] = { 1, 2 };
+	const uint32_t rates[] = { rate, rate * 2 * (bits / 8) };
+	const uint16_t align[] = { 2 * (bits / 8), bits };
+	const uint32_t riff = 36 + data, fmt_len = 16;
+	FILE *f = fopen(path, "wb");
+
+	if (!f)
+		return -1;
+	fwrite("RIFF", 1, 4, f);
+	fwrite(&riff, 4, 1, f);
+	fwrite("WAVEfmt ", 1, 8, f);
+	fwrite(&fmt_len, 4, 1, f);
+	fwrite(fmt, 2, 2, f);
+	fwrite(rates, 4, 2, f);
+	fwrite(align, 2, 2, f);
+	fwrite("data", 1, 4, f);
+	fwrite(&data, 4, 1, f);
+	/* Low-level noise: no zero pages, and nothing loud if a DAC is on the other end */
+	const uint32_t width = bits / 8, samples = data / width;
+	unsigned char block[65536];
+	size_t n = 0;
+	uint32_t x = 1;
+	for (uint32_t i = 0; i < samples; i++) {
+		x = x * 1103515245u + 12345u;
+		const int32_t s = (int32_t)(x >> 24) - 128;
+		memcpy(block + n, &s, width);	/* little-endian: the low bytes */
+		n += width;
+		if (n + width > sizeof(block) || i == samples - 1) {
+			if (fwrite(block, 1, n, f) != n) {
+				fclose(f);
+				return -1;
+			}
+			n = 0;
+		}
+	}
+	return fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <QUA_STATS player binary> [audio core] [seconds] [device]\n", argv[0]);
+		return 1;
+	}
+	const char *player = argv[1];
+	audio_core = argc > 2 ? atoi(argv[2]) : 2;
+	const int seconds = argc > 3 ? atoi(argv[3]) : 30;
+	const char *device = argc > 4 ? argv[4] : "null";
+
+	int bits, rate;
+	char name[256];
+	snprintf(name, sizeof(name), "%s", player);
+	if (sscanf(basename(name), "qua-player-%d-%d", &bits, &rate) != 2 || (bits != 16 && bits != 32)) {
+		fprintf(stderr, "%s: expected a qua-player-<bits>-<rate> binary\n", player);
+		return 1;
+	}
+
+	char wav[64];
+	snprintf(wav, sizeof(wav), "/dev/shm/bench-jitter-%d.wav", getpid());
+	if (write_wav(wav, bits, rate, seconds) != 0) {
+		fprintf(stderr, "cannot write %s\n", wav);
+		return 1;
+	}
+
+	printf("%s on cpu %d, %d s per run, device %s\n", player, audio_core, seconds, device);
+	printf("%-10s %8s %9s %9s %9s %9s\n", "config", "wakes", "p50_us", "p99_us", "p99.99_us", "max_us");
+	fflush(stdout);
+	for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+		unlink(STATS_PATH);
+		start_stress(configs[i].mask);
+		usleep(500000);	/* let the stressors reach steady state */
+		const int err = run_player(player, wav, device);
+		stop_stress();
+		if (err != 0 || stat_value("wake_samples") <= 0) {
+			printf("%-10s %8s\n", configs[i].name, err ? "failed" : "no stats (not a QUA_STATS build?)");
+			continue;
+		}
+		printf("%-10s %8.0f %9.1f %9.1f %9.1f %9.1f\n", configs[i].name, stat_value("wake_samples"),
+		       stat_value("wake_p50_us"), stat_value("wake_p99_us"), stat_value("wake_p9999_us"),
+		       stat_value("wake_max_us"));
+		fflush(stdout);
+	}
+	unlink(wav);
+	return 0;
+}
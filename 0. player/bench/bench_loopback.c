@@ -0,0 +1,345 @@
+/*
+ * bench_loopback - end-to-end check of a player binary through snd-aloop
+ *
+ * Plays two generated tracks back to back through the real player into the
+ * Loopback card (as the daemon does: the second player starts when the first
+ * exits) and captures the other end. Every frame carries its own index:
+ *   right = frame index (low bits for 16-bit), left = hash(track, index)
+ * so each captured frame identifies itself. Checks and reports:
+ *   - bit-perfect: left must equal the hash of the index in right
+ *   - dropped/duplicated frames: index jumps and repeats
+ *   - inserted silence: zero frames inside a track
+ *   - start latency: spawn -> first frame of the track at the capture end
+ *   - transition gap: last frame of track A -> first frame of track B
+ *
+ * Needs the aloop module (modprobe snd-aloop), no DAC. Timing is on the
+ * loopback's own clock: capture frame n arrives at capture start + n/rate.
+ *
+ * usage: bench_loopback <player binary, e.g. bin/qua-player-32-48000> [seconds] [runs]
+ */
+#define _GNU_SOURCE
+#include <alsa/asoundlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern char **environ;
+
+#define TRACKS		2
+#define WAV_DIR		"/dev/shm"
+#define CAPTURE_SLACK_S	10	/* startup, gaps and drain on top of the tracks */
+
+static int bits, rate;
+static long track_frames;
+
+/* Capture side: one contiguous buffer for the whole run */
+static struct {
+	snd_pcm_t *pcm;
+	unsigned char *buf;
+	long frames, max_frames;
+	double start;		/* CLOCK_MONOTONIC at snd_pcm_start */
+	volatile int stop;
+} cap;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Never zero, so a signal frame can't be mistaken for silence */
+static uint32_t frame_hash(int track, uint32_t i)
+{
+	uint32_t x = i * 0x9E3779B1u ^ (track + 1) * 0x85EBCA77u;
+	x ^= x >> 15;
+	x *= 0x2C1B3C6Du;
+	x ^= x >> 12;
+	if (bits == 16)
+		x &= 0xFFFF;
+	return x ? x : 1;
+}
+
+static int write_track(const char *path, int track)
+{
+	const int bps = bits / 8;
+	const uint32_t data = (uint32_t)(track_frames * 2 * bps);
+	unsigned char hdr[44];
+	uint32_t v32;
+	uint16_t v16;
+
+	memcpy(hdr, "RIFF", 4);
+	v32 = 36 + data; memcpy(hdr + 4, &v32, 4);
+	memcpy(hdr + 8, "WAVEfmt ", 8);
+	v32 = 16; memcpy(hdr + 16, &v32, 4);
+	v16 = 1; memcpy(hdr + 20, &v16, 2);
+	v16 = 2; memcpy(hdr + 22, &v16, 2);
+	v32 = rate; memcpy(hdr + 24, &v32, 4);
+	v32 = rate * 2 * bps; memcpy(hdr + 28, &v32, 4);
+	v16 = 2 * bps; memcpy(hdr + 32, &v16, 2);
+	v16 = bits; memcpy(hdr + 34, &v16, 2);
+	memcpy(hdr + 36, "data", 4);
+	memcpy(hdr + 40, &data, 4);
+
+	unsigned char *pcm = malloc(data);
+	if (!pcm)
+		return -1;
+	for (long i = 0; i < track_frames; i++) {
+		uint32_t l = frame_hash(track, i), r = (uint32_t)i;
+		if (bits == 16) {
+			uint16_t s[2] = { l, r };
+			memcpy(pcm + i * 4, s, 4);
+		} else {
+			uint32_t s[2] = { l, r };
+			memcpy(pcm + i * 8, s, 8);
+		}
+	}
+
+	FILE *f = fopen(path, "wb");
+	int ok = f && fwrite(hdr, 1, 44, f) == 44 && fwrite(pcm, 1, data, f) == data;
+	if (f)
+		fclose(f);
+	free(pcm);
+	return ok ? 0 : -1;
+}
+
+static int find_loopback(void)
+{
+	FILE *f = fopen("/proc/asound/cards", "r");
+	char line[256];
+	int card = -1;
+
+	if (!f)
+		return -1;
+	while (fgets(line, sizeof(line), f))
+		if (strstr(line, "Loopback") && sscanf(line, "%d", &card) == 1)
+			break;
+	fclose(f);
+	return card;
+}
+
+static void *capture_worker(void *arg)
+{
+	(void)arg;
+	const int frame_bytes = 2 * bits / 8;
+
+	while (!cap.stop && cap.frames < cap.max_frames) {
+		long want = cap.max_frames - cap.frames;
+		if (want > 1024)
+			want = 1024;
+		snd_pcm_sframes_t n = snd_pcm_readi(cap.pcm, cap.buf + cap.frames * frame_bytes, want);
+		if (n < 0) {
+			fprintf(stderr, "capture: %s\n", snd_strerror(n));
+			break;
+		}
+		cap.frames += n;
+	}
+	return NULL;
+}
+
+static int capture_open(int card)
+{
+	char dev[32];
+	snprintf(dev, sizeof(dev), "hw:%d,1,0", card);
+	int err = snd_pcm_open(&cap.pcm, dev, SND_PCM_STREAM_CAPTURE, 0);
+	if (err == 0)
+		err = snd_pcm_set_params(cap.pcm, bits == 16 ? SND_PCM_FORMAT_S16_LE : SND_PCM_FORMAT_S32_LE,
+					 SND_PCM_ACCESS_RW_INTERLEAVED, 2, rate, 0, 20000);
+	if (err < 0) {
+		fprintf(stderr, "capture %s: %s\n", dev, snd_strerror(err));
+		return -1;
+	}
+	return 0;
+}
+
+/* Run one player to completion; returns its spawn time or < 0 */
+static double play(const char *player, const char *wav, const char *device)
+{
+	char *args[] = { (char *)player, (char *)wav, (char *)device, "0", "0", NULL };
+	pid_t pid;
+	int status;
+	const double t = now();
+
+	if (posix_spawn(&pid, player, NULL, NULL, args, environ) != 0)
+		return -1;
+	waitpid(pid, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		fprintf(stderr, "%s exited with status 0x%x\n", player, status);
+	return t;
+}
+
+typedef struct {
+	long first, last;	/* capture positions */
+	long verified, errors, dropped, duplicated, silence;
+	long index;		/* last index seen */
+} track_stats_t;
+
+static void analyse(track_stats_t st[TRACKS])
+{
+	const int frame_bytes = 2 * bits / 8;
+	int cur = -1;
+	long zeros = 0;
+
+	for (int t = 0; t < TRACKS; t++)
+		st[t] = (track_stats_t){ .first = -1, .index = -1 };
+
+	for (long j = 0; j < cap.frames; j++) {
+		uint32_t l, r;
+		if (bits == 16) {
+			uint16_t s[2];
+			memcpy(s, cap.buf + j * frame_bytes, 4);
+			l = s[0];
+			r = s[1];
+		} else {
+			uint32_t s[2];
+			memcpy(s, cap.buf + j * frame_bytes, 8);
+			l = s[0];
+			r = s[1];
+		}
+		if (l == 0 && r == 0) {
+			zeros++;
+			continue;
+		}
+
+		/*
+		 * Index from the right channel, unwrapped against the last one.
+		 * Tracks play in order: never look back at an earlier track (a
+		 * 16-bit hash alone would match a wrong one now and then).
+		 */
+		int t;
+		long idx = 0;
+		for (t = cur < 0 ? 0 : cur; t < TRACKS; t++) {
+			idx = bits == 16 ? st[t].index + (int16_t)(uint16_t)(r - (uint32_t)st[t].index)
+					 : (long)r;
+			if (idx >= 0 && idx < track_frames && frame_hash(t, idx) == l)
+				break;
+		}
+		if (t == TRACKS) {
+			if (cur >= 0)
+				st[cur].errors++;
+			continue;
+		}
+
+		track_stats_t *s = &st[t];
+		if (s->first < 0) {
+			s->first = j;
+			s->dropped += idx;	/* missing head */
+		} else {
+			const long delta = idx - s->index;
+			if (delta > 1)
+				s->dropped += delta - 1;
+			else if (delta < 1)
+				s->duplicated += 1 - delta;
+			if (t == cur)
+				s->silence += zeros;
+		}
+		zeros = 0;
+		s->index = idx;
+		s->last = j;
+		s->verified++;
+		cur = t;
+	}
+	for (int t = 0; t < TRACKS; t++)
+		if (st[t].first >= 0)
+			st[t].dropped += track_frames - 1 - st[t].index;	/* missing tail */
+		else
+			st[t].dropped = track_frames;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <player binary> [seconds] [runs]\n", argv[0]);
+		return 1;
+	}
+	const char *player = argv[1];
+	const int seconds = argc > 2 ? atoi(argv[2]) : 5;
+	const int runs = argc > 3 ? atoi(argv[3]) : 3;
+
+	char name[256];
+	snprintf(name, sizeof(name), "%s", player);
+	if (sscanf(basename(name), "qua-player-%d-%d", &bits, &rate) != 2 || (bits != 16 && bits != 32)) {
+		fprintf(stderr, "%s: expected a qua-player-<bits>-<rate> binary\n", player);
+		return 1;
+	}
+	const int card = find_loopback();
+	if (card < 0) {
+		fprintf(stderr, "no Loopback card (modprobe snd-aloop)\n");
+		return 1;
+	}
+	char device[32];
+	snprintf(device, sizeof(device), "hw:%d,0", card);
+
+	track_frames = (long)seconds * rate;
+	char wav[TRACKS][64];
+	for (int t = 0; t < TRACKS; t++) {
+		snprintf(wav[t], sizeof(wav[t]), WAV_DIR "/bench-loopback-%d-%d.wav", getpid(), t);
+		if (write_track(wav[t], t) != 0) {
+			fprintf(stderr, "cannot write %s\n", wav[t]);
+			return 1;
+		}
+	}
+
+	cap.max_frames = ((long)TRACKS * seconds + CAPTURE_SLACK_S) * rate;
+	cap.buf = malloc(cap.max_frames * 2 * bits / 8);
+	if (!cap.buf)
+		return 1;
+
+	printf("%s via %s: %d-bit %d Hz, %d x %d s per run\n", player, device, bits, rate, TRACKS, seconds);
+	int failed = 0;
+	double lat_sum[TRACKS] = { 0 }, gap_sum = 0;
+	for (int run = 0; run < runs; run++) {
+		/* Capture first: aloop then fixes the format the player must match */
+		if (capture_open(card) != 0)
+			return 1;
+		cap.frames = 0;
+		cap.stop = 0;
+		snd_pcm_start(cap.pcm);
+		cap.start = now();
+		pthread_t tid;
+		pthread_create(&tid, NULL, capture_worker, NULL);
+
+		double spawned[TRACKS];
+		for (int t = 0; t < TRACKS; t++)
+			spawned[t] = play(player, wav[t], device);
+		usleep(200000);
+		cap.stop = 1;
+		pthread_join(tid, NULL);
+		snd_pcm_close(cap.pcm);
+
+		track_stats_t st[TRACKS];
+		analyse(st);
+		printf("run %d:", run + 1);
+		for (int t = 0; t < TRACKS; t++) {
+			const double latency = st[t].first < 0 ? -1 :
+				(cap.start + (double)st[t].first / rate - spawned[t]) * 1e3;
+			lat_sum[t] += latency;
+			printf(" %c: %ld/%ld exact, %ld bad, %ld dropped, %ld dup, %ld silence, start %.1f ms;",
+			       'A' + t, st[t].verified, track_frames, st[t].errors, st[t].dropped,
+			       st[t].duplicated, st[t].silence, latency);
+			if (st[t].verified != track_frames || st[t].errors || st[t].dropped ||
+			    st[t].duplicated || st[t].silence)
+				failed = 1;
+		}
+		const double gap = st[0].first < 0 || st[1].first < 0 ? -1 :
+			(double)(st[1].first - st[0].last - 1) / rate * 1e3;
+		gap_sum += gap;
+		printf(" gap %.1f ms\n", gap);
+	}
+	printf("avg start latency A %.1f ms, B %.1f ms, transition gap %.1f ms: %s\n",
+	       lat_sum[0] / runs, lat_sum[1] / runs, gap_sum / runs, failed ? "NOT BIT-PERFECT" : "bit-perfect");
+
+	for (int t = 0; t < TRACKS; t++)
+		unlink(wav[t]);
+	free(cap.buf);
+	return failed;
+}
@@ -9,6 +9,7 @@
 // --- SYSTEM CONFIGURATION - HUGE PAGE ---
 // IMPORTANT: Adjust this value to your system's Huge Page size
 #define HUGE_PAGE_SIZE 0x80000000 // 2GB
+#define HUGE_PAGE_1GB 0x40000000UL // MAP_HUGE_1GB granule, arena grows by this
 #define ALIGN_4K 4096
 
 // Audio Configuration General
@@ -22,6 +22,7 @@ static __attribute__((always_inline)) inline long my_poll_x86(struct pollfd *fds
     return ret;
 }
 
+#ifndef NULL_SINK
 // Direct ioctl - no errno, no branch, no TLS write
 static __attribute__((always_inline)) inline void my_ioctl_x86(int fd, unsigned long request, void *arg) {
     register long rax __asm__("rax") = (long)__NR_ioctl;
@@ -37,5 +38,24 @@ static __attribute__((always_inline)) inline void my_ioctl_x86(int fd, unsigned
         : "rcx", "r11", "memory"
     );
 }
+#else
+// Null sink: same register shape, but read(timerfd) consumes the expired
+// period into arg (the stand-in sync_ptr) instead of SYNC_PTR
+static __attribute__((always_inline)) inline void my_ioctl_x86(int fd, unsigned long request, void *arg) {
+    register long rax __asm__("rax") = (long)__NR_read;
+    register long rdi __asm__("rdi") = (long)fd;
+    register long rsi __asm__("rsi") = (long)arg;
+    register long rdx __asm__("rdx") = 8;
+    long dummy_ret;
+    (void)request;
+
+    __asm__ __volatile__ (
+        "syscall"
+        : "=a"(dummy_ret)
+        : "r"(rax), "r"(rdi), "r"(rsi), "r"(rdx)
+        : "rcx", "r11", "memory"
+    );
+}
+#endif
 
 #endif // CUSTOM_SYSCALL_H
@@ -0,0 +1,347 @@
+#ifndef FLAC_RESIDENT_H
+#define FLAC_RESIDENT_H
+// Compressed residency (build with -DFLAC_RESIDENT, link PLAYER_LIBS=-lFLAC).
+// A .flac track stays compressed in memory and a decoder thread fills a ring
+// of huge-page periods far ahead of the hot loop. The thread runs on another
+// core of the audio core's L3 (not its SMT sibling) at normal priority.
+// In the daemon's isolated partition (LAUNCHER_ISOLATE) that core is the
+// one it adds beside the audio core when CACHE_FLAC is on.
+// The loop itself is the same copy: period_source() masks the cursor into
+// the ring, and for WAV input the mask is all ones, so nothing changes there.
+// Flow control adds nothing to the loop either: the decoder reads appl_ptr,
+// which the loop advances anyway, and only refills periods already copied.
+// The other direction is checked, not waited on: before each copy the loop
+// compares the period against the published `written`, and a decoder that
+// fell behind shows up as late periods (stale ring contents) in the report.
+
+#ifdef FLAC_RESIDENT
+#include <FLAC/stream_decoder.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#ifndef FLAC_RING_BYTES
+#define FLAC_RING_BYTES (64UL << 20) // ~40 s at 192 kHz/32-bit
+#endif
+#define FLAC_PRIME_PERIODS 32 // decoded before playback starts
+
+_Static_assert((FLAC_RING_BYTES & (FLAC_RING_BYTES - 1)) == 0 &&
+                   FLAC_RING_BYTES % BYTES_PER_PERIOD == 0,
+               "FLAC_RING_BYTES must be a power of two multiple of a period");
+
+// ~0 (no wrap) unless a FLAC track is playing out of the ring
+static uintptr_t flac_ring_mask = ~(uintptr_t)0;
+
+static struct
+{
+  const FLAC__byte *file;
+  size_t file_len;
+  size_t file_pos;
+  FLAC__StreamDecoder *decoder;
+  uint64_t track_bytes;
+  char *ring;                             // FLAC_RING_BYTES + one zero period
+  uint64_t span;                          // track + round-up + drain period
+  uint64_t written;                       // atomic, stored by the decoder thread only
+  int primed;                             // atomic
+  volatile snd_pcm_uframes_t *appl_ptr;   // atomic, NULL until playback starts
+  snd_pcm_uframes_t appl_base;
+  uint64_t head_bytes;
+  int failed;
+} flac_res;
+
+// What the loop may copy: everything for WAV input, the decoder's published
+// `written` once a FLAC track plays out of the ring
+static const uint64_t flac_all_written = ~(uint64_t)0;
+static const uint64_t *flac_written = &flac_all_written;
+
+// 1 if the decoder has not filled the period at cursor yet; head and tail
+// periods come from the silence period and are never late. The loop passes
+// flac_written read once up front and sums the result in a local, so the
+// check touches no globals.
+static inline unsigned int flac_resident_check(uintptr_t cursor, uintptr_t track_begin, uintptr_t track_span,
+                                               const uint64_t *written)
+{
+  const uintptr_t offset = cursor - track_begin;
+  return offset < track_span && offset + BYTES_PER_PERIOD > __atomic_load_n(written, __ATOMIC_ACQUIRE);
+}
+
+static int flac_resident_probe(int fd)
+{
+  char magic[4];
+  return pread(fd, magic, 4, 0) == 4 && memcmp(magic, "fLaC", 4) == 0;
+}
+
+static FLAC__StreamDecoderReadStatus
+flac_resident_read(const FLAC__StreamDecoder *decoder, FLAC__byte buffer[], size_t *bytes, void *client)
+{
+  (void)decoder;
+  (void)client;
+  const size_t left = flac_res.file_len - flac_res.file_pos;
+  if (left == 0)
+  {
+    *bytes = 0;
+    return FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM;
+  }
+  if (*bytes > left)
+    *bytes = left;
+  memcpy(buffer, flac_res.file + flac_res.file_pos, *bytes);
+  flac_res.file_pos += *bytes;
+  return FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
+}
+
+// Bytes of the track the hot loop has finished copying
+static uint64_t flac_resident_consumed(void)
+{
+  volatile snd_pcm_uframes_t *const appl = __atomic_load_n(&flac_res.appl_ptr, __ATOMIC_ACQUIRE);
+  if (!appl)
+    return 0;
+  const int64_t played = (int64_t)((*appl - flac_res.appl_base) * BYTES_PER_AUDIO_FRAME) -
+                         (int64_t)flac_res.head_bytes;
+  return played > 0 ? (uint64_t)played : 0;
+}
+
+// Block until [written, end) may be overwritten, publishing "primed" once
+// enough is decoded for playback to start (or the ring is full)
+static void flac_resident_reserve(uint64_t end)
+{
+  uint64_t prime = FLAC_PRIME_PERIODS * BYTES_PER_PERIOD;
+  if (prime > FLAC_RING_BYTES)
+    prime = FLAC_RING_BYTES;
+  if (prime > flac_res.span)
+    prime = flac_res.span;
+  if (flac_res.written >= prime || end > flac_resident_consumed() + FLAC_RING_BYTES)
+    __atomic_store_n(&flac_res.primed, 1, __ATOMIC_RELEASE);
+
+  const struct timespec period = {0, (long)((long long)FRAMES_PER_PERIOD * 1000000000LL / TARGET_SAMPLE_RATE)};
+  while (end > flac_resident_consumed() + FLAC_RING_BYTES)
+    clock_nanosleep(CLOCK_MONOTONIC, 0, &period, NULL);
+}
+
+static FLAC__StreamDecoderWriteStatus
+flac_resident_write(const FLAC__StreamDecoder *decoder, const FLAC__Frame *frame,
+                    const FLAC__int32 *const buffer[], void *client)
+{
+  (void)decoder;
+  (void)client;
+  // Left-justify into sample_t, as the converter's 16/24 -> 32 paths do
+  const unsigned int shift = 8 * sizeof(sample_t) - frame->header.bits_per_sample;
+  const uint64_t bytes = (uint64_t)frame->header.blocksize * BYTES_PER_AUDIO_FRAME;
+  if (flac_res.written + bytes > flac_res.track_bytes)
+    return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+  flac_resident_reserve(flac_res.written + bytes);
+
+  uint64_t written = flac_res.written;
+  for (unsigned int i = 0; i < frame->header.blocksize; i++)
+  {
+    sample_t *const out = (sample_t *)(flac_res.ring + (written & (FLAC_RING_BYTES - 1)));
+    out[0] = (sample_t)((uint32_t)buffer[0][i] << shift);
+    out[1] = (sample_t)((uint32_t)buffer[1][i] << shift);
+    written += BYTES_PER_AUDIO_FRAME;
+  }
+  __atomic_store_n(&flac_res.written, written, __ATOMIC_RELEASE);
+  return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+}
+
+static void flac_resident_metadata(const FLAC__StreamDecoder *decoder,
+                                   const FLAC__StreamMetadata *metadata, void *client)
+{
+  (void)decoder;
+  WavHeader *const header = client;
+  if (metadata->type != FLAC__METADATA_TYPE_STREAMINFO)
+    return;
+  const FLAC__StreamMetadata_StreamInfo *const si = &metadata->data.stream_info;
+  header->num_channels = si->channels;
+  header->sample_rate = si->sample_rate;
+  header->bit_depth = si->bits_per_sample;
+  header->data_bytes = si->total_samples * BYTES_PER_AUDIO_FRAME;
+}
+
+static void flac_resident_error(const FLAC__StreamDecoder *decoder,
+                                FLAC__StreamDecoderErrorStatus status, void *client)
+{
+  (void)decoder;
+  (void)client;
+  DEBUG_PRINT("FLAC: decode error %d\n", (int)status);
+  (void)status;
+}
+
+// Map the file and read STREAMINFO; returns 0 (no data offset) or -1
+static off_t flac_resident_load(int fd, WavHeader *header)
+{
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0)
+    return -1;
+  void *const file = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  if (file == MAP_FAILED)
+    return -1;
+  flac_res.file = file;
+  flac_res.file_len = st.st_size;
+
+  flac_res.decoder = FLAC__stream_decoder_new();
+  if (!flac_res.decoder ||
+      FLAC__stream_decoder_init_stream(flac_res.decoder, flac_resident_read, NULL, NULL, NULL, NULL,
+                                       flac_resident_write, flac_resident_metadata,
+                                       flac_resident_error, header) != FLAC__STREAM_DECODER_INIT_STATUS_OK ||
+      !FLAC__stream_decoder_process_until_end_of_metadata(flac_res.decoder))
+    return -1;
+
+  // Unknown length (total_samples 0) cannot be laid out ahead of time
+  if (header->num_channels != SAMPLES_PER_FRAME || header->data_bytes == 0 ||
+      header->bit_depth > 8 * sizeof(sample_t))
+  {
+    DEBUG_PRINT("FLAC: unsupported stream (%u ch, %u bit, %llu bytes)\n", header->num_channels,
+                header->bit_depth, (unsigned long long)header->data_bytes);
+    return -1;
+  }
+  flac_res.track_bytes = header->data_bytes;
+  DEBUG_PRINT("FLAC: %zu bytes compressed, %llu bytes PCM\n", flac_res.file_len,
+              (unsigned long long)header->data_bytes);
+  return 0;
+}
+
+// Other cores of the audio core's L3, without its SMT siblings; all other
+// online CPUs if that leaves nothing. Stays put if the cpuset forbids both.
+static void flac_resident_pin(int audio_cpu)
+{
+  cpu_set_t set, siblings;
+  CPU_ZERO(&set);
+  CPU_ZERO(&siblings);
+  for (int pass = 0; pass < 2; pass++)
+  {
+    char path[96], list[256];
+    snprintf(path, sizeof(path), pass ? "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list"
+                                      : "/sys/devices/system/cpu/cpu%d/cache/index3/shared_cpu_list",
+             audio_cpu);
+    FILE *const f = fopen(path, "r");
+    if (!f)
+      continue;
+    if (fgets(list, sizeof(list), f))
+    {
+      // "a-b,c,..." ranges
+      for (char *p = list; *p && *p != '\n';)
+      {
+        char *end;
+        const long lo = strtol(p, &end, 10);
+        long hi = lo;
+        if (*end == '-')
+          hi = strtol(end + 1, &end, 10);
+        for (long cpu = lo; cpu <= hi && cpu < CPU_SETSIZE; cpu++)
+          CPU_SET(cpu, pass ? &siblings : &set);
+        p = *end == ',' ? end + 1 : end;
+        if (end == p && *p != ',')
+          break;
+      }
+    }
+    fclose(f);
+  }
+  CPU_SET(audio_cpu, &siblings);
+  CPU_AND(&siblings, &siblings, &set);
+  CPU_XOR(&set, &set, &siblings);
+
+  if (CPU_COUNT(&set) == 0 || sched_setaffinity(0, sizeof(set), &set) != 0)
+  {
+    const long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    CPU_ZERO(&set);
+    for (long cpu = 0; cpu < cpus && cpu < CPU_SETSIZE; cpu++)
+      if (cpu != audio_cpu)
+        CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+  }
+}
+
+static void *flac_resident_worker(void *arg)
+{
+  flac_resident_pin((int)(intptr_t)arg);
+  if (!FLAC__stream_decoder_process_until_end_of_stream(flac_res.decoder) ||
+      flac_res.written != flac_res.track_bytes)
+    DEBUG_PRINT("FLAC: decoded %llu of %llu bytes\n", (unsigned long long)flac_res.written,
+                (unsigned long long)flac_res.track_bytes);
+
+  // Silence for the period round-up and the drain period (and a short decode)
+  while (flac_res.written < flac_res.span)
+  {
+    const uint64_t end = (flac_res.written + BYTES_PER_PERIOD) & ~(uint64_t)(BYTES_PER_PERIOD - 1);
+    flac_resident_reserve(end);
+    memset(flac_res.ring + (flac_res.written & (FLAC_RING_BYTES - 1)), 0, end - flac_res.written);
+    __atomic_store_n(&flac_res.written, end, __ATOMIC_RELEASE);
+  }
+  __atomic_store_n(&flac_res.primed, 1, __ATOMIC_RELEASE);
+  FLAC__stream_decoder_delete(flac_res.decoder);
+  return NULL;
+}
+
+// Ring (2MB huge pages if available) plus a zero period past its end, and
+// the decoder thread filling it. Aligned like the arena, since main() assumes
+// HUGE_PAGE_SIZE alignment of the track base. Returns the ring or NULL.
+static sample_t *flac_resident_ring(void)
+{
+  const size_t len = FLAC_RING_BYTES + (2UL << 20);
+  char *const reserve = mmap(NULL, len + HUGE_PAGE_SIZE, PROT_NONE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (reserve == MAP_FAILED)
+    return NULL;
+  char *const ring = (char *)(((uintptr_t)reserve + HUGE_PAGE_SIZE - 1) & ~((uintptr_t)HUGE_PAGE_SIZE - 1));
+  if (ring > reserve)
+    munmap(reserve, ring - reserve);
+  if (reserve + HUGE_PAGE_SIZE > ring)
+    munmap(ring + len, reserve + HUGE_PAGE_SIZE - ring);
+
+  if (mmap(ring, len, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB | MAP_HUGE_2MB | MAP_POPULATE,
+           -1, 0) == MAP_FAILED &&
+      mmap(ring, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_POPULATE,
+           -1, 0) == MAP_FAILED)
+  {
+    munmap(ring, len);
+    return NULL;
+  }
+  flac_res.ring = ring;
+  flac_res.span = ((flac_res.track_bytes + BYTES_PER_PERIOD - 1) & ~(uint64_t)(BYTES_PER_PERIOD - 1)) +
+                  BYTES_PER_PERIOD;
+
+  // Normal priority, not the inherited SCHED_FIFO 99
+  pthread_attr_t attr;
+  struct sched_param param = {.sched_priority = 0};
+  pthread_t thread;
+  pthread_attr_init(&attr);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+  pthread_attr_setschedparam(&attr, &param);
+  const int err = pthread_create(&thread, &attr, flac_resident_worker, (void *)(intptr_t)sched_getcpu());
+  pthread_attr_destroy(&attr);
+  if (err != 0)
+  {
+    munmap(ring, len);
+    return NULL;
+  }
+  pthread_detach(thread);
+  flac_ring_mask = FLAC_RING_BYTES - 1;
+  flac_written = &flac_res.written;
+  return (sample_t *)ring;
+}
+
+static const sample_t *flac_resident_silence(void)
+{
+  return (const sample_t *)(flac_res.ring + FLAC_RING_BYTES);
+}
+
+static void flac_resident_wait_primed(void)
+{
+  const struct timespec tick = {0, 100000};
+  while (!__atomic_load_n(&flac_res.primed, __ATOMIC_ACQUIRE))
+    clock_nanosleep(CLOCK_MONOTONIC, 0, &tick, NULL);
+}
+
+// Hand the decoder the loop's appl_ptr once it has queued `queued` periods
+static void flac_resident_attach(volatile snd_pcm_uframes_t *appl_ptr, size_t queued, size_t head_periods)
+{
+  flac_res.appl_base = *appl_ptr - queued * FRAMES_PER_PERIOD;
+  flac_res.head_bytes = head_periods * BYTES_PER_PERIOD;
+  __atomic_store_n(&flac_res.appl_ptr, appl_ptr, __ATOMIC_RELEASE);
+}
+#endif
+
+#endif // FLAC_RESIDENT_H
@@ -0,0 +1,53 @@
+#ifndef MEMFD_SOURCE_H
+#define MEMFD_SOURCE_H
+// Source buffer straight from the converter's memfd (daemon CONVERT_MEMFD).
+// The daemon hands over a sealed memfd whose data starts on a page of its
+// own size (4K, or the huge page for MFD_HUGETLB), so the track is mapped
+// where it already is instead of being read into the hugepage arena: one
+// copy of the PCM less, and no read() before playback.
+// Same shape as the arena: HUGE_PAGE_SIZE aligned, track first, zeros
+// behind it for the period round-up and the drain period (the file's own
+// zero tail, or an anonymous mapping past EOF).
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static sample_t *memfd_map_source(int fd, off_t data_offset, uint64_t data_bytes)
+{
+  const int seals = fcntl(fd, F_GET_SEALS);
+  struct stat st;
+  if (seals == -1 || !(seals & F_SEAL_WRITE) || fstat(fd, &st) != 0 ||
+      data_offset % st.st_blksize != 0)
+    return NULL;
+
+  const size_t page = st.st_blksize;
+  const size_t file_len = (st.st_size - data_offset + page - 1) & ~(page - 1);
+  const size_t span = (data_bytes + 2 * BYTES_PER_PERIOD + ALIGN_4K - 1) & ~(size_t)(ALIGN_4K - 1);
+  const size_t len = span > file_len ? span : file_len;
+
+  // Aligned window out of an oversized address-space reservation
+  char *const reserve = mmap(NULL, len + HUGE_PAGE_SIZE, PROT_NONE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (reserve == MAP_FAILED)
+    return NULL;
+  char *const base = (char *)(((uintptr_t)reserve + HUGE_PAGE_SIZE - 1) & ~((uintptr_t)HUGE_PAGE_SIZE - 1));
+  if (base > reserve)
+    munmap(reserve, base - reserve);
+  if (reserve + HUGE_PAGE_SIZE > base)
+    munmap(base + len, reserve + HUGE_PAGE_SIZE - base);
+
+  if (mmap(base, file_len, PROT_READ, MAP_SHARED | MAP_FIXED | MAP_POPULATE,
+           fd, data_offset) == MAP_FAILED ||
+      (len > file_len &&
+       mmap(base + file_len, len - file_len, PROT_READ,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_POPULATE, -1, 0) == MAP_FAILED))
+  {
+    munmap(base, len);
+    return NULL;
+  }
+  DEBUG_PRINT("Source: sealed memfd mapped in place (%zu bytes, %zu-byte pages)\n", len, page);
+  return (sample_t *)base;
+}
+
+#endif // MEMFD_SOURCE_H
@@ -0,0 +1,153 @@
+#ifndef NULL_SINK_H
+#define NULL_SINK_H
+// Null sink: simulated DMA ring for running the player without a DAC.
+// Build with -DNULL_SINK. The ALSA calls used by main() are redirected here,
+// so the prefill, poll, copy and sync sequence of the hot loop is unchanged.
+//
+// "Hardware" is a timerfd firing once per period at the nominal rate:
+//   - the ring is 2 anonymous, page-aligned periods (same shape as the DMA area)
+//   - poll() on the timerfd wakes once per elapsed period, like POLLOUT on avail_min
+//   - the sync syscall reads the timerfd, consuming the expiration (see
+//     my_ioctl_x86 in custom_syscall.h), so one syscall per period remains
+//   - drain waits for the two queued periods to play out
+//
+// Shims are noinline so main() keeps the same CFG as the ALSA build and
+// profiles taken here apply to it (only setup_alsa differs).
+
+#include <string.h>
+#include <sys/timerfd.h>
+#include <time.h>
+
+#define NULL_SINK_PERIOD_NS \
+  ((long long)FRAMES_PER_PERIOD * 1000000000LL / TARGET_SAMPLE_RATE)
+
+static struct
+{
+  int timer_fd;
+  char *ring;
+  snd_pcm_channel_area_t area;
+  snd_pcm_uframes_t appl_ptr;
+  unsigned char sync_ptr[136]; // stand-in for struct snd_pcm_sync_ptr, receives
+                               // the expiration count in its first 8 bytes
+} null_sink;
+
+static int setup_alsa(snd_pcm_t **handle, const char *device)
+{
+  (void)device;
+  null_sink.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  null_sink.ring = mmap(NULL, BYTES_PER_BUFFER, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+#ifdef DEBUG
+  if (null_sink.timer_fd < 0 || null_sink.ring == MAP_FAILED)
+  {
+    perror("null sink setup");
+    return -1;
+  }
+#endif
+  null_sink.area.addr = null_sink.ring;
+  null_sink.area.first = 0;
+  null_sink.area.step = BYTES_PER_AUDIO_FRAME * CHAR_BIT;
+  *handle = (snd_pcm_t *)&null_sink; // opaque, never dereferenced
+  DEBUG_PRINT("Null sink: %lld ns per period\n", NULL_SINK_PERIOD_NS);
+  return 0;
+}
+
+static __attribute__((noinline)) int
+null_sink_mmap_begin(snd_pcm_t *pcm, const snd_pcm_channel_area_t **areas,
+                     snd_pcm_uframes_t *offset, snd_pcm_uframes_t *frames)
+{
+  (void)pcm;
+  *areas = &null_sink.area;
+  *offset = 0;
+  *frames = FRAMES_PER_BUFFER;
+  return 0;
+}
+
+static __attribute__((noinline)) volatile snd_pcm_uframes_t *
+null_sink_appl_ptr(snd_pcm_t *pcm)
+{
+  (void)pcm;
+  return &null_sink.appl_ptr;
+}
+
+static __attribute__((noinline)) int null_sink_hw_fd(snd_pcm_t *pcm)
+{
+  (void)pcm;
+  return null_sink.timer_fd;
+}
+
+static __attribute__((noinline)) void *null_sink_hw_sync_ptr(snd_pcm_t *pcm)
+{
+  (void)pcm;
+  return null_sink.sync_ptr;
+}
+
+static __attribute__((noinline)) unsigned long null_sink_sync_ptr_cmd(void)
+{
+  return 0;
+}
+
+static __attribute__((noinline)) int null_sink_notify_hw(snd_pcm_t *pcm)
+{
+  (void)pcm;
+  return 0;
+}
+
+// First expiry after one period: the second prefilled period is "playing".
+// Absolute, so expiry n is exactly origin + n periods (QUA_STATS reference)
+static __attribute__((noinline)) int null_sink_start(snd_pcm_t *pcm)
+{
+  (void)pcm;
+  struct timespec origin;
+  clock_gettime(CLOCK_MONOTONIC, &origin);
+  const long long first_ns = origin.tv_nsec + NULL_SINK_PERIOD_NS;
+  const struct itimerspec its = {
+      .it_interval = {NULL_SINK_PERIOD_NS / 1000000000LL, NULL_SINK_PERIOD_NS % 1000000000LL},
+      .it_value = {origin.tv_sec + first_ns / 1000000000LL, first_ns % 1000000000LL},
+  };
+#ifdef QUA_STATS
+  qua_stats_timer_origin = origin;
+#endif
+  return timerfd_settime(null_sink.timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static __attribute__((noinline)) int
+null_sink_poll_descriptors(snd_pcm_t *pcm, struct pollfd *pfds, unsigned int space)
+{
+  (void)pcm;
+  (void)space;
+  pfds[0].fd = null_sink.timer_fd;
+  pfds[0].events = POLLIN;
+  pfds[0].revents = 0;
+  return 1;
+}
+
+static __attribute__((noinline)) int null_sink_drain(snd_pcm_t *pcm)
+{
+  (void)pcm;
+  unsigned long long played = 0, ticks;
+  while (played < PERIODS_PER_BUFFER && read(null_sink.timer_fd, &ticks, sizeof(ticks)) == sizeof(ticks))
+    played += ticks;
+  return 0;
+}
+
+static __attribute__((noinline)) int null_sink_close(snd_pcm_t *pcm)
+{
+  (void)pcm;
+  munmap(null_sink.ring, BYTES_PER_BUFFER);
+  return close(null_sink.timer_fd);
+}
+
+#define snd_pcm_mmap_begin null_sink_mmap_begin
+#define snd_pcm_appl_ptr null_sink_appl_ptr
+#define snd_pcm_hw_fd null_sink_hw_fd
+#define snd_pcm_hw_sync_ptr null_sink_hw_sync_ptr
+#define snd_pcm_sync_ptr_cmd null_sink_sync_ptr_cmd
+#define snd_pcm_notify_hw null_sink_notify_hw
+#define snd_pcm_start null_sink_start
+#define snd_pcm_poll_descriptors null_sink_poll_descriptors
+#define snd_pcm_drain null_sink_drain
+#define snd_pcm_close null_sink_close
+#define snd_strerror(err) strerror(-(err)) // errors here are -errno
+
+#endif // NULL_SINK_H
@@ -0,0 +1,31 @@
+#ifndef NUMA_LOCAL_H
+#define NUMA_LOCAL_H
+// Keep the huge-page arena on the audio core's NUMA node.
+// The launcher pins us next to the DAC's controller; the arena is populated
+// inside mmap (MAP_POPULATE + mlockall MCL_FUTURE), so the policy is set for
+// the duration of that call instead of mbind()ing an already-faulted range.
+// Under MPOL_BIND hugetlb reserves from the bound node only, so a node short
+// of 1GB pages makes mmap fail cleanly and the caller retries unbound.
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define QUA_MPOL_DEFAULT 0
+#define QUA_MPOL_BIND 2
+
+static void numa_bind_local(void)
+{
+  unsigned int cpu, node;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0 || node >= 64)
+    return;
+  const unsigned long mask = 1UL << node;
+  syscall(SYS_set_mempolicy, QUA_MPOL_BIND, &mask, 64);
+  DEBUG_PRINT("NUMA: binding arena to node %u (cpu %u)\n", node, cpu);
+}
+
+static void numa_unbind(void)
+{
+  syscall(SYS_set_mempolicy, QUA_MPOL_DEFAULT, NULL, 0);
+}
+
+#endif // NUMA_LOCAL_H
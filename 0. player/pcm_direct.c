@@ -0,0 +1,230 @@
+// pcm_direct.c - Raw-ioctl PCM backend for hw: devices (build with -DDIRECT_PCM)
+// Opens /dev/snd/pcmCxDyp itself and does what alsa-lib's hw plugin would:
+// HW_REFINE/HW_PARAMS/SW_PARAMS/PREPARE, mmap of the DMA buffer and a
+// sync_ptr for the hot loop. No alsa.conf parsing, no plugin chain, no
+// userspace hw_params refinement.
+// Separate TU: the kernel uapi header and asoundlib.h cannot share one.
+#ifdef DIRECT_PCM
+#define _GNU_SOURCE
+#define PCM_DIRECT_IMPL
+#include <ctype.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <sound/asound.h>
+
+#include "config_consts.h"
+#include "debug.h"
+#include "pcm_direct.h"
+
+#if TARGET_BITDEPTH == 16
+#define DIRECT_FORMAT SNDRV_PCM_FORMAT_S16_LE
+#else
+#define DIRECT_FORMAT SNDRV_PCM_FORMAT_S32_LE
+#endif
+
+// Must match SYNC_PTR_STATUS_HW_PTR in qua_stats.h
+_Static_assert(offsetof(struct snd_pcm_sync_ptr, s.status.hw_ptr) == 16,
+               "sync_ptr layout");
+
+static struct
+{
+  int fd;
+  void *dma;
+  struct snd_pcm_sync_ptr sync_ptr;
+} pcm = {.fd = -1};
+
+// "hw:C", "hw:C,D", "hw:CARD=C,DEV=D"; card by index or id (/proc/asound/<id>)
+static int parse_hw_device(const char *device, int *card, int *dev)
+{
+  if (strncmp(device, "hw:", 3) != 0)
+    return -1;
+  const char *p = device + 3;
+  if (strncmp(p, "CARD=", 5) == 0)
+    p += 5;
+
+  char id[64];
+  const size_t n = strcspn(p, ",");
+  if (n == 0 || n >= sizeof(id))
+    return -1;
+  memcpy(id, p, n);
+  id[n] = '\0';
+  if (isdigit((unsigned char)id[0]))
+  {
+    *card = atoi(id);
+  }
+  else
+  {
+    char path[96], link[32];
+    snprintf(path, sizeof(path), "/proc/asound/%s", id);
+    const ssize_t len = readlink(path, link, sizeof(link) - 1);
+    if (len <= 4 || strncmp(link, "card", 4) != 0)
+      return -1;
+    link[len] = '\0';
+    *card = atoi(link + 4);
+  }
+
+  *dev = 0;
+  p += n;
+  if (*p == ',')
+  {
+    p++;
+    if (strncmp(p, "DEV=", 4) == 0)
+      p += 4;
+    *dev = atoi(p);
+  }
+  return 0;
+}
+
+// hw_params "any": every mask bit set, every interval unbounded
+static void hw_params_any(struct snd_pcm_hw_params *params)
+{
+  memset(params, 0, sizeof(*params));
+  for (int i = 0; i <= SNDRV_PCM_HW_PARAM_LAST_MASK - SNDRV_PCM_HW_PARAM_FIRST_MASK; i++)
+    memset(params->masks[i].bits, 0xff, sizeof(params->masks[i].bits));
+  for (int i = 0; i <= SNDRV_PCM_HW_PARAM_LAST_INTERVAL - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL; i++)
+    params->intervals[i].max = ~0u;
+  params->rmask = ~0u;
+  params->info = ~0u;
+}
+
+static void hw_params_mask(struct snd_pcm_hw_params *params, int param, unsigned int val)
+{
+  struct snd_mask *mask = &params->masks[param - SNDRV_PCM_HW_PARAM_FIRST_MASK];
+  memset(mask->bits, 0, sizeof(mask->bits));
+  mask->bits[val >> 5] = 1u << (val & 31);
+}
+
+static void hw_params_exact(struct snd_pcm_hw_params *params, int param, unsigned int val)
+{
+  struct snd_interval *interval = &params->intervals[param - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL];
+  interval->min = interval->max = val;
+  interval->openmin = interval->openmax = 0;
+  interval->integer = 1;
+}
+
+int pcm_direct_open(const char *device)
+{
+  int card, dev;
+  if (parse_hw_device(device, &card, &dev) != 0)
+    return -1;
+
+  char path[64];
+  snprintf(path, sizeof(path), "/dev/snd/pcmC%dD%dp", card, dev);
+  pcm.fd = open(path, O_RDWR | O_CLOEXEC);
+  if (pcm.fd < 0)
+    return -1;
+
+  int pversion = SNDRV_PCM_VERSION;
+  ioctl(pcm.fd, SNDRV_PCM_IOCTL_USER_PVERSION, &pversion);
+
+  // Same constraints as setup_alsa, all exact; the kernel picks the rest
+  struct snd_pcm_hw_params hw;
+  hw_params_any(&hw);
+  hw_params_mask(&hw, SNDRV_PCM_HW_PARAM_ACCESS, SNDRV_PCM_ACCESS_MMAP_INTERLEAVED);
+  hw_params_mask(&hw, SNDRV_PCM_HW_PARAM_FORMAT, DIRECT_FORMAT);
+  hw_params_mask(&hw, SNDRV_PCM_HW_PARAM_SUBFORMAT, SNDRV_PCM_SUBFORMAT_STD);
+  hw_params_exact(&hw, SNDRV_PCM_HW_PARAM_CHANNELS, SAMPLES_PER_FRAME);
+  hw_params_exact(&hw, SNDRV_PCM_HW_PARAM_RATE, TARGET_SAMPLE_RATE);
+  hw_params_exact(&hw, SNDRV_PCM_HW_PARAM_PERIOD_SIZE, FRAMES_PER_PERIOD);
+  hw_params_exact(&hw, SNDRV_PCM_HW_PARAM_BUFFER_SIZE, FRAMES_PER_BUFFER);
+  if (ioctl(pcm.fd, SNDRV_PCM_IOCTL_HW_REFINE, &hw) < 0 ||
+      ioctl(pcm.fd, SNDRV_PCM_IOCTL_HW_PARAMS, &hw) < 0)
+  {
+    DEBUG_PRINT("Direct PCM: %s rejects the fixed hw_params\n", path);
+    goto fail;
+  }
+
+  // Explicit START only; wake once a whole period is free
+  struct snd_pcm_sw_params sw = {0};
+  sw.period_step = 1;
+  sw.avail_min = FRAMES_PER_PERIOD;
+  sw.xfer_align = 1;
+  sw.start_threshold = ~0ul >> 1;
+  sw.stop_threshold = FRAMES_PER_BUFFER;
+  sw.proto = SNDRV_PCM_VERSION;
+#ifdef QUA_STATS
+  sw.tstamp_mode = SNDRV_PCM_TSTAMP_ENABLE;
+  sw.tstamp_type = SNDRV_PCM_TSTAMP_TYPE_MONOTONIC_RAW;
+#endif
+  if (ioctl(pcm.fd, SNDRV_PCM_IOCTL_SW_PARAMS, &sw) < 0)
+    goto fail;
+
+  pcm.dma = mmap(NULL, BYTES_PER_BUFFER, PROT_READ | PROT_WRITE, MAP_SHARED,
+                 pcm.fd, SNDRV_PCM_MMAP_OFFSET_DATA);
+  if (pcm.dma == MAP_FAILED)
+    goto fail;
+
+  if (ioctl(pcm.fd, SNDRV_PCM_IOCTL_PREPARE) < 0)
+    goto fail_unmap;
+
+  // Read back appl_ptr/avail_min once; from here on the loop owns appl_ptr
+  pcm.sync_ptr.flags = SNDRV_PCM_SYNC_PTR_APPL | SNDRV_PCM_SYNC_PTR_AVAIL_MIN;
+  if (ioctl(pcm.fd, SNDRV_PCM_IOCTL_SYNC_PTR, &pcm.sync_ptr) < 0)
+    goto fail_unmap;
+
+  DEBUG_PRINT("Direct PCM: %s, boundary %lu\n", path, (unsigned long)sw.boundary);
+  return 0;
+
+fail_unmap:
+  munmap(pcm.dma, BYTES_PER_BUFFER);
+fail:
+  close(pcm.fd);
+  pcm.fd = -1;
+  return -1;
+}
+
+void *pcm_direct_dma(void)
+{
+  return pcm.dma;
+}
+
+volatile unsigned long *pcm_direct_appl_ptr(void)
+{
+  return &pcm.sync_ptr.c.control.appl_ptr;
+}
+
+int pcm_direct_fd(void)
+{
+  return pcm.fd;
+}
+
+void *pcm_direct_sync_ptr(void)
+{
+  return &pcm.sync_ptr;
+}
+
+unsigned long pcm_direct_sync_ptr_cmd(void)
+{
+  return SNDRV_PCM_IOCTL_SYNC_PTR;
+}
+
+// Push appl_ptr to the kernel, as the hot loop does
+void pcm_direct_notify(void)
+{
+  pcm.sync_ptr.flags = SNDRV_PCM_SYNC_PTR_AVAIL_MIN;
+  ioctl(pcm.fd, SNDRV_PCM_IOCTL_SYNC_PTR, &pcm.sync_ptr);
+}
+
+int pcm_direct_start(void)
+{
+  return ioctl(pcm.fd, SNDRV_PCM_IOCTL_START) < 0 ? -1 : 0;
+}
+
+int pcm_direct_drain(void)
+{
+  return ioctl(pcm.fd, SNDRV_PCM_IOCTL_DRAIN) < 0 ? -1 : 0;
+}
+
+void pcm_direct_close(void)
+{
+  munmap(pcm.dma, BYTES_PER_BUFFER);
+  close(pcm.fd);
+  pcm.fd = -1;
+}
+#endif // DIRECT_PCM
@@ -0,0 +1,128 @@
+#ifndef PCM_DIRECT_H
+#define PCM_DIRECT_H
+// Direct PCM backend (-DDIRECT_PCM): raw ioctls on /dev/snd/pcmCxDyp for
+// hw: devices, see pcm_direct.c. Anything else (plugins, "default", ...)
+// falls back to alsa-lib at runtime.
+
+// --- Backend API (pcm_direct.c) ---
+int pcm_direct_open(const char *device); // 0 = direct backend in use
+void *pcm_direct_dma(void);
+volatile unsigned long *pcm_direct_appl_ptr(void);
+int pcm_direct_fd(void);
+void *pcm_direct_sync_ptr(void);
+unsigned long pcm_direct_sync_ptr_cmd(void);
+void pcm_direct_notify(void);
+int pcm_direct_start(void);
+int pcm_direct_drain(void);
+void pcm_direct_close(void);
+
+#ifndef PCM_DIRECT_IMPL
+// --- Dispatch (qua_player.c) ---
+// Same approach as null_sink.h: main() keeps calling the snd_pcm_* names,
+// which resolve to the direct backend when setup picked it. The handle is a
+// sentinel, never dereferenced. The hot loop only uses what these return.
+#ifdef NULL_SINK
+#error "DIRECT_PCM and NULL_SINK are mutually exclusive"
+#endif
+
+#define PCM_DIRECT_HANDLE ((snd_pcm_t *)&pcm_direct_open)
+
+static int setup_pcm(snd_pcm_t **handle, const char *device)
+{
+  if (pcm_direct_open(device) == 0)
+  {
+    *handle = PCM_DIRECT_HANDLE;
+    return 0;
+  }
+  DEBUG_PRINT("Direct PCM unavailable for %s, using alsa-lib\n", device);
+  return setup_alsa(handle, device);
+}
+
+static __attribute__((noinline)) int
+pcm_mmap_begin(snd_pcm_t *handle, const snd_pcm_channel_area_t **areas,
+               snd_pcm_uframes_t *offset, snd_pcm_uframes_t *frames)
+{
+  if (handle != PCM_DIRECT_HANDLE)
+    return snd_pcm_mmap_begin(handle, areas, offset, frames);
+  static snd_pcm_channel_area_t area;
+  area.addr = pcm_direct_dma();
+  area.first = 0;
+  area.step = BYTES_PER_AUDIO_FRAME * CHAR_BIT;
+  *areas = &area;
+  *offset = 0;
+  *frames = FRAMES_PER_BUFFER;
+  return 0;
+}
+
+static __attribute__((noinline)) volatile snd_pcm_uframes_t *pcm_appl_ptr(snd_pcm_t *handle)
+{
+  return handle == PCM_DIRECT_HANDLE ? pcm_direct_appl_ptr() : snd_pcm_appl_ptr(handle);
+}
+
+static __attribute__((noinline)) int pcm_hw_fd(snd_pcm_t *handle)
+{
+  return handle == PCM_DIRECT_HANDLE ? pcm_direct_fd() : snd_pcm_hw_fd(handle);
+}
+
+static __attribute__((noinline)) void *pcm_hw_sync_ptr(snd_pcm_t *handle)
+{
+  return handle == PCM_DIRECT_HANDLE ? pcm_direct_sync_ptr() : snd_pcm_hw_sync_ptr(handle);
+}
+
+// Same ioctl number either way
+static __attribute__((noinline)) unsigned long pcm_sync_ptr_cmd(void)
+{
+  return pcm_direct_sync_ptr_cmd();
+}
+
+static __attribute__((noinline)) void pcm_notify_hw(snd_pcm_t *handle)
+{
+  if (handle == PCM_DIRECT_HANDLE)
+    pcm_direct_notify();
+  else
+    snd_pcm_notify_hw(handle);
+}
+
+static __attribute__((noinline)) int pcm_start(snd_pcm_t *handle)
+{
+  return handle == PCM_DIRECT_HANDLE ? pcm_direct_start() : snd_pcm_start(handle);
+}
+
+static __attribute__((noinline)) int
+pcm_poll_descriptors(snd_pcm_t *handle, struct pollfd *pfds, unsigned int space)
+{
+  if (handle != PCM_DIRECT_HANDLE)
+    return snd_pcm_poll_descriptors(handle, pfds, space);
+  pfds[0].fd = pcm_direct_fd();
+  pfds[0].events = POLLOUT | POLLERR;
+  pfds[0].revents = 0;
+  return 1;
+}
+
+static __attribute__((noinline)) int pcm_drain(snd_pcm_t *handle)
+{
+  return handle == PCM_DIRECT_HANDLE ? pcm_direct_drain() : snd_pcm_drain(handle);
+}
+
+static __attribute__((noinline)) int pcm_close(snd_pcm_t *handle)
+{
+  if (handle != PCM_DIRECT_HANDLE)
+    return snd_pcm_close(handle);
+  pcm_direct_close();
+  return 0;
+}
+
+#define setup_alsa setup_pcm
+#define snd_pcm_mmap_begin pcm_mmap_begin
+#define snd_pcm_appl_ptr pcm_appl_ptr
+#define snd_pcm_hw_fd pcm_hw_fd
+#define snd_pcm_hw_sync_ptr pcm_hw_sync_ptr
+#define snd_pcm_sync_ptr_cmd pcm_sync_ptr_cmd
+#define snd_pcm_notify_hw pcm_notify_hw
+#define snd_pcm_start pcm_start
+#define snd_pcm_poll_descriptors pcm_poll_descriptors
+#define snd_pcm_drain pcm_drain
+#define snd_pcm_close pcm_close
+#endif // PCM_DIRECT_IMPL
+
+#endif // PCM_DIRECT_H
@@ -15,6 +15,11 @@
 #include "qua_player_pgo.h" 
 #include "debug.h"
 #include "wav_header.h" // To parse Wav
+#include "qua_stats.h" // -DQUA_STATS: DAC rate/drift measurement
+#include "numa_local.h" // Arena on the audio core's node
+#include "memfd_source.h" // Sealed memfd from the converter as source buffer
+#include "flac_resident.h" // -DFLAC_RESIDENT: FLAC kept compressed, decoded ahead into a ring
+#include "standby_gate.h" // Parked on the daemon's eventfd until the previous track ends
 #define memcpy_custom avx2_stream_copy_zero_x86_x8
 // avx2_stream_copy_intrinsic
 // avx2_stream_copy_zero_x8
@@ -22,6 +27,22 @@
 
 extern void __gcov_reset(void);
 
+// Virtual padding: a stream cursor outside the track span is fed from the
+// single zeroed period instead of silence materialized in the track buffer.
+// Unsigned wrap makes cursors before the track fall outside the span too.
+// A FLAC track plays out of the decoder's ring; ring_mask is ~0 otherwise.
+static __attribute__((always_inline)) inline const sample_t *
+period_source(uintptr_t cursor, uintptr_t track_begin, uintptr_t track_span,
+              uintptr_t ring_mask, const sample_t *silence)
+{
+  return (cursor - track_begin) < track_span
+             ? (const sample_t *)(track_begin + ((cursor - track_begin) & ring_mask))
+             : silence;
+}
+
+#ifdef NULL_SINK
+#include "null_sink.h" // Simulated DMA ring, replaces setup_alsa and the snd_pcm_* calls below
+#else
 static int setup_alsa(snd_pcm_t **handle, const char *device)
 {
   snd_pcm_hw_params_t *hw_params;
@@ -142,9 +163,29 @@ static int setup_alsa(snd_pcm_t **handle, const char *device)
   // 11. Clean up hardware parameters structure (after successful application)
   // snd_pcm_hw_params_free(hw_params);
 
+#ifdef QUA_STATS
+  // Timestamp each period interrupt, on the clock NTP cannot slew
+  snd_pcm_sw_params_t *sw_params;
+  snd_pcm_sw_params_alloca(&sw_params);
+  snd_pcm_sw_params_current(*handle, sw_params);
+  snd_pcm_sw_params_set_tstamp_mode(*handle, sw_params, SND_PCM_TSTAMP_ENABLE);
+  snd_pcm_sw_params_set_tstamp_type(*handle, sw_params, SND_PCM_TSTAMP_TYPE_MONOTONIC_RAW);
+  err = snd_pcm_sw_params(*handle, sw_params);
+#ifdef DEBUG
+  if (err < 0)
+  {
+    fprintf(stderr, "Cannot enable timestamps: %s\n", snd_strerror(err));
+  }
+#endif
+#endif
+
   // 12. Prepare the PCM device
   return snd_pcm_prepare(*handle);
 }
+#endif
+#ifdef DIRECT_PCM
+#include "pcm_direct.h" // Raw-ioctl backend for hw: devices, alsa-lib as fallback
+#endif
 
 __attribute__((optimize("align-loops=64")))
 int main(int argc, char *argv[])
@@ -159,8 +200,8 @@ int main(int argc, char *argv[])
 
   if (unlikely(argc < 2))
   {
-    printf("Usage: %s <wav_file> [device_name] \n Example: qua_player test.wav "
-           "hw:0,0\n",
+    printf("Usage: %s <wav_file> [device_name] [head_frames] [tail_frames] [gate_fd]\n"
+           " Example: qua_player test.wav hw:0,0 4800 9600\n",
            argv[0]);
     return -1;
   }
@@ -179,6 +220,14 @@ int main(int argc, char *argv[])
     device_name = argv[2];
   }
 
+  // Head/tail silence in frames, rounded up to whole periods
+  const size_t head_frames = (argc > 3) ? strtoul(argv[3], NULL, 10) : 0;
+  const size_t tail_frames = (argc > 4) ? strtoul(argv[4], NULL, 10) : 0;
+  const size_t head_periods = (head_frames + FRAMES_PER_PERIOD - 1) / FRAMES_PER_PERIOD;
+  const size_t tail_periods = (tail_frames + FRAMES_PER_PERIOD - 1) / FRAMES_PER_PERIOD;
+  // Warm standby: load, then wait on this eventfd before opening the device
+  const int gate_fd = (argc > 5) ? atoi(argv[5]) : -1;
+
   DEBUG_PRINT("ALSA Optimized Mmap Player - Huge Page Attempt\n");
   DEBUG_PRINT("File: %s, Device: %s\n", filename, device_name);
 
@@ -191,7 +240,17 @@ int main(int argc, char *argv[])
     return -1;
   }
 #endif
+#ifdef FLAC_RESIDENT
+  const int flac_mode = flac_resident_probe(fd);
+  off_t data_offset = flac_mode ? flac_resident_load(fd, &header) : read_wav_header(fd, &header);
+  if (unlikely(flac_mode && data_offset < 0))
+  {
+    close(fd);
+    return -1;
+  }
+#else
   off_t data_offset = read_wav_header(fd, &header);
+#endif
 // Previously had off_t type, which was used to check
 // TODO : move debug into read_wav_header itself
 // #ifdef DEBUG
@@ -202,71 +261,94 @@ int main(int argc, char *argv[])
 //   }
 // #endif
 
-  snd_pcm_t *pcm_handle_writable = NULL;
-  err = setup_alsa(&pcm_handle_writable, device_name);
-
-#ifdef DEBUG
-  if (unlikely(err < 0))
+  // Whole track + period round-up + drain period, in 1GB pages. HUGE_PAGE_SIZE
+  // is the floor; RF64 tracks past it get a bigger arena instead of a cut
+  size_t arena_size = (header.data_bytes + 2 * BYTES_PER_PERIOD + HUGE_PAGE_1GB - 1) & ~(HUGE_PAGE_1GB - 1);
+  if (arena_size < HUGE_PAGE_SIZE)
+    arena_size = HUGE_PAGE_SIZE;
+
+  // Sealed memfd from the converter: map it in place, nothing to read
+#ifdef FLAC_RESIDENT
+  sample_t *audio_data_writable = flac_mode ? flac_resident_ring()
+                                            : memfd_map_source(fd, data_offset, header.data_bytes);
+  if (unlikely(flac_mode && !audio_data_writable))
   {
     close(fd);
     return -1;
   }
+#else
+  sample_t *audio_data_writable = memfd_map_source(fd, data_offset, header.data_bytes);
 #endif
-  snd_pcm_t *const pcm_handle = pcm_handle_writable;
-  DEBUG_PRINT("Attempting fixed 1 GB Huge Page allocation for %zu bytes\n",
-              HUGE_PAGE_SIZE);
-
-  // --- HUGE PAGE ALLOCATION FOR SOURCE BUFFER
-  sample_t *audio_data_writable = (sample_t *)mmap(NULL,
-                                                   HUGE_PAGE_SIZE, // 1GB
-                                                   PROT_READ | PROT_WRITE,
-                                                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE | MAP_HUGE_1GB,
-                                                   -1,
-                                                   0);
-#ifdef DEBUG
-  if (unlikely(audio_data_writable == MAP_FAILED))
+  if (!audio_data_writable)
   {
-    perror("FATAL: Failed to allocate Huge Pages for audio data (mmap MAP_HUGETLB)");
-    fprintf(stderr, "Huge Page allocation is mandatory. Check system configuration (e.g., /proc/sys/vm/nr_hugepages).\n");
-    // Cleanup and exit immediately as Huge Pages are required.
-    snd_pcm_close(pcm_handle);
-    close(fd);
-    return -1;
-  }
-#endif
-
+    DEBUG_PRINT("Attempting 1 GB Huge Page allocation of %zu bytes\n", arena_size);
+    // --- HUGE PAGE ALLOCATION FOR SOURCE BUFFER
+    numa_bind_local();
+    audio_data_writable = (sample_t *)mmap(NULL,
+                                           arena_size, // 1GB pages
+                                           PROT_READ | PROT_WRITE,
+                                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE | MAP_HUGE_1GB,
+                                           -1,
+                                           0);
+    if (unlikely(audio_data_writable == MAP_FAILED))
+    {
+      // Local node is short of 1GB pages: take them from any node
+      numa_unbind();
+      audio_data_writable = (sample_t *)mmap(NULL, arena_size, PROT_READ | PROT_WRITE,
+                                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE | MAP_HUGE_1GB,
+                                             -1, 0);
+    }
+    numa_unbind();
+    // A standby shares the pool with the player still running: without a
+    // second arena it steps aside and the daemon launches in the usual way
+    if (unlikely(gate_fd >= 0 && audio_data_writable == MAP_FAILED))
+    {
+      close(fd);
+      return -1;
+    }
 #ifdef DEBUG
-  // Read audio data (omitted for brevity, assume it's here)
-  if (unlikely(lseek(fd, data_offset, SEEK_SET) != data_offset))
-  {
-    fprintf(stderr, "Failed to seek to audio data\n");
-    munmap(audio_data_writable, HUGE_PAGE_SIZE);
-    close(fd);
-    return -1;
-  }
+    if (unlikely(audio_data_writable == MAP_FAILED))
+    {
+      perror("FATAL: Failed to allocate Huge Pages for audio data (mmap MAP_HUGETLB)");
+      fprintf(stderr, "Huge Page allocation is mandatory. Check system configuration (e.g., /proc/sys/vm/nr_hugepages).\n");
+      // Cleanup and exit immediately as Huge Pages are required.
+      close(fd);
+      return -1;
+    }
 #endif
 
-  ssize_t total_read = 0;
-  // Read as much as possible, to reduce "hotness" of read comment for LLVM-BOLT profiling sake
-  while (total_read < header.data_bytes)
-  {
-    ssize_t bytes_read = read(fd, (char *)audio_data_writable + total_read,
-                              header.data_bytes - total_read);
 #ifdef DEBUG
-    if (unlikely(bytes_read <= 0))
+    // Read audio data (omitted for brevity, assume it's here)
+    if (unlikely(lseek(fd, data_offset, SEEK_SET) != data_offset))
     {
-      fprintf(stderr, "Failed to read audio data\n");
-      munmap(audio_data_writable, HUGE_PAGE_SIZE);
-      snd_pcm_close(pcm_handle);
+      fprintf(stderr, "Failed to seek to audio data\n");
+      munmap(audio_data_writable, arena_size);
       close(fd);
       return -1;
     }
 #endif
-    total_read += bytes_read;
+
+    size_t total_read = 0;
+    // Read as much as possible, to reduce "hotness" of read comment for LLVM-BOLT profiling sake
+    while (total_read < header.data_bytes)
+    {
+      ssize_t bytes_read = read(fd, (char *)audio_data_writable + total_read,
+                                header.data_bytes - total_read);
+#ifdef DEBUG
+      if (unlikely(bytes_read <= 0))
+      {
+        fprintf(stderr, "Failed to read audio data\n");
+        munmap(audio_data_writable, arena_size);
+        close(fd);
+        return -1;
+      }
+#endif
+      total_read += bytes_read;
+    }
+    memset((char *)audio_data_writable + header.data_bytes, 0, arena_size - header.data_bytes);
+    err = mprotect((void *)audio_data_writable, arena_size, PROT_READ);
   }
   close(fd);
-  memset((char *)audio_data_writable + header.data_bytes, 0, HUGE_PAGE_SIZE - header.data_bytes);
-  err = mprotect((void *)audio_data_writable, HUGE_PAGE_SIZE, PROT_READ);
   const sample_t *const audio_data = (const sample_t *)__builtin_assume_aligned(
       audio_data_writable,
       HUGE_PAGE_SIZE // 1GB alignment guaranteed
@@ -279,16 +361,56 @@ int main(int argc, char *argv[])
   }
 #endif
 
+  // The device is opened only now: a standby must not hold it while the
+  // previous track is still playing
+  if (gate_fd >= 0 && standby_wait(gate_fd) != 0)
+    return -1;
+
+  snd_pcm_t *pcm_handle_writable = NULL;
+  err = setup_alsa(&pcm_handle_writable, device_name);
+
+#ifdef DEBUG
+  if (unlikely(err < 0))
+  {
+    return -1;
+  }
+#endif
+  snd_pcm_t *const pcm_handle = pcm_handle_writable;
+
   // PHASE 1: Setup source pointers directly
   const size_t total_frames = header.data_bytes / (2 * sizeof(sample_t));
 
-  const sample_t *current_src = audio_data;
   // Pad with zeros to wait for drain
   const sample_t *const end_src_boundary = audio_data + (total_frames * SAMPLES_PER_FRAME) +
                                            (((FRAMES_PER_PERIOD * SAMPLES_PER_FRAME) - ((total_frames * SAMPLES_PER_FRAME) % (FRAMES_PER_PERIOD * SAMPLES_PER_FRAME))) % (FRAMES_PER_PERIOD * SAMPLES_PER_FRAME)) +
                                            (FRAMES_PER_PERIOD * SAMPLES_PER_FRAME);
-  DEBUG_PRINT("Phase 1: Set up source pointers - start=%p, end=%p\n",
-              current_src, end_src_boundary);
+
+  // The drain period is already zeroed and aligned: it is the silence source
+  // for every virtual head/tail period, so padding costs no memory
+#ifdef FLAC_RESIDENT
+  // (the ring is shorter than the track: its zero period sits past its end)
+  const sample_t *const silence = (const sample_t *)__builtin_assume_aligned(
+      flac_mode ? flac_resident_silence() : end_src_boundary - (FRAMES_PER_PERIOD * SAMPLES_PER_FRAME), ALIGN_4K);
+#else
+  const sample_t *const silence = (const sample_t *)__builtin_assume_aligned(
+      end_src_boundary - (FRAMES_PER_PERIOD * SAMPLES_PER_FRAME), ALIGN_4K);
+#endif
+  const uintptr_t track_begin = (uintptr_t)audio_data;
+  const uintptr_t track_span = (uintptr_t)end_src_boundary - track_begin;
+#ifdef FLAC_RESIDENT
+  // Locals, or the loop reloads both globals after every copy and syscall
+  const uintptr_t ring_mask = flac_ring_mask;
+  const uint64_t *const written = flac_written;
+  unsigned long late_periods = 0;
+#else
+  const uintptr_t ring_mask = ~(uintptr_t)0;
+#endif
+
+  // Stream cursor covers head periods + track + tail periods
+  uintptr_t current_src = track_begin - head_periods * BYTES_PER_PERIOD;
+  const uintptr_t end_src_virtual = track_begin + track_span + tail_periods * BYTES_PER_PERIOD;
+  DEBUG_PRINT("Phase 1: Set up source pointers - start=%p, end=%p, head=%zu, tail=%zu periods\n",
+              (void *)current_src, (void *)end_src_virtual, head_periods, tail_periods);
 
   // --- 1. Attempt to get buffer area for the full two periods ---
   const snd_pcm_channel_area_t *areas;
@@ -321,14 +443,20 @@ int main(int argc, char *argv[])
   DEBUG_PRINT("Set mmap base address: %p\n", mmap_audio_base);
 
   // madvise((void *)audio_data, HUGE_PAGE_SIZE, MADV_SEQUENTIAL);
+#ifdef FLAC_RESIDENT
+  if (flac_mode)
+    flac_resident_wait_primed();
+#endif
   memcpy_custom((sample_t *)__builtin_assume_aligned(mmap_audio_base, ALIGN_4K),
-                       (const sample_t *)__builtin_assume_aligned(current_src, ALIGN_4K));
+                       (const sample_t *)__builtin_assume_aligned(
+                           period_source(current_src, track_begin, track_span, ring_mask, silence), ALIGN_4K));
 
   // --- FILL PERIOD 2 ---
   memcpy_custom((sample_t *)__builtin_assume_aligned((mmap_audio_base + BYTES_PER_PERIOD), ALIGN_4K),
-                       (const sample_t *)__builtin_assume_aligned(current_src + FRAMES_PER_PERIOD * SAMPLES_PER_FRAME, ALIGN_4K));
+                       (const sample_t *)__builtin_assume_aligned(
+                           period_source(current_src + BYTES_PER_PERIOD, track_begin, track_span, ring_mask, silence), ALIGN_4K));
 
-  current_src += FRAMES_PER_PERIOD * SAMPLES_PER_FRAME * 2;
+  current_src += BYTES_PER_PERIOD * 2;
   // _mm_sfence();
 
   // Update pointer and notify
@@ -338,6 +466,10 @@ int main(int argc, char *argv[])
   void *const sync_ptr = snd_pcm_hw_sync_ptr(pcm_handle_cached);
   const unsigned long sync_cmd = snd_pcm_sync_ptr_cmd();
   *appl_ptr += (FRAMES_PER_PERIOD * 2); // Advance by two periods
+#ifdef FLAC_RESIDENT
+  if (flac_mode)
+    flac_resident_attach(appl_ptr, 2, head_periods);
+#endif
   snd_pcm_notify_hw(pcm_handle);
 
   DEBUG_PRINT("Pre-filled two periods sequentially.\n");
@@ -352,13 +484,11 @@ int main(int argc, char *argv[])
 
   // TEST TODO
   const char *const restrict mmap_audio_base_cached = (const char *const)__builtin_assume_aligned(mmap_audio_base, ALIGN_4K);
-  const sample_t *src = (const sample_t *)__builtin_assume_aligned(
-      current_src,
-      ALIGN_4K);
+  uintptr_t src = current_src;
   // register const sample_t *src asm("rdi") = (const sample_t *)__builtin_assume_aligned(                                                                                                                
   //       current_src,
   //       ALIGN_4K);      
-  const sample_t *const end_src = end_src_boundary;
+  const uintptr_t end_src = end_src_virtual;
   
   // const sample_t *end_src = end_src_boundary;
   // asm volatile("" : "+r"(end_src));  
@@ -371,6 +501,10 @@ int main(int argc, char *argv[])
   const int npfds = 1;
   // const int npfds = snd_pcm_poll_descriptors_count(pcm_handle_cached);
   snd_pcm_poll_descriptors(pcm_handle_cached, pfd, npfds);
+#ifdef QUA_STATS
+  qua_stats_sample_t *const stats_samples = qua_stats_alloc((end_src - src) / BYTES_PER_PERIOD);
+  qua_stats_sample_t *stats_cursor = stats_samples;
+#endif
   PGO_PROFILING_RESET();
   // XOR-pointer swap: toggle between two addresses with single XOR (no addition)
   const uintptr_t dest0 = (uintptr_t)mmap_audio_base_cached;
@@ -384,15 +518,26 @@ int main(int argc, char *argv[])
   {
     __asm__ volatile (".p2align 6" ::: "memory"); // Force 64-byte alignment for outer loop
     my_poll_x86(pfd, npfds, -1);
+#ifdef QUA_STATS
+    clock_gettime(QUA_STATS_CLOCK, &stats_cursor->wake);
+#endif
+#ifdef FLAC_RESIDENT
+    late_periods += flac_resident_check(src, track_begin, track_span, written);
+#endif
     memcpy_custom((sample_t *)__builtin_assume_aligned((void *)dest, ALIGN_4K),
-                         (const sample_t *)__builtin_assume_aligned(src, ALIGN_4K));
+                         (const sample_t *)__builtin_assume_aligned(
+                             period_source(src, track_begin, track_span, ring_mask, silence), ALIGN_4K));
     *appl_ptr += FRAMES_PER_PERIOD;
     *(unsigned int *)sync_ptr = SNDRV_PCM_SYNC_PTR_AVAIL_MIN;
     my_ioctl_x86(pcm_fd, sync_cmd, sync_ptr);
+#ifdef QUA_STATS
+    stats_cursor->status = *(const qua_stats_status_t *)((const char *)sync_ptr + SYNC_PTR_STATUS_HW_PTR);
+    stats_cursor++;
+#endif
     // ioctl(pcm_fd, sync_cmd, sync_ptr);
     // snd_pcm_notify_hw(pcm_handle);
 
-    src += FRAMES_PER_PERIOD * SAMPLES_PER_FRAME;
+    src += BYTES_PER_PERIOD;
     dest ^= dest_toggle;  // Single XOR swaps between dest0 and dest1
 
   } while (likely(src != end_src));
@@ -422,8 +567,23 @@ int main(int argc, char *argv[])
   snd_pcm_drain(pcm_handle);
   snd_pcm_close(pcm_handle);
   DEBUG_PRINT("\nPlayback completed!\n");
+#ifdef FLAC_RESIDENT
+  if (late_periods)
+    DEBUG_PRINT("FLAC: decoder fell behind, %lu periods played stale\n", late_periods);
+#endif
+#ifdef QUA_STATS
+  if (stats_samples)
+  {
+#ifdef FLAC_RESIDENT
+    qua_stats_report(stats_samples, stats_cursor - stats_samples, late_periods);
+#else
+    qua_stats_report(stats_samples, stats_cursor - stats_samples, 0);
+#endif
+  }
+#endif
 
-  // Send "play-next" to socket daemon
+#ifndef NULL_SINK
+  // Send "play-next" to socket daemon (a benchmark run must not drive it)
   int sock = socket(AF_UNIX, SOCK_STREAM, 0);
   if (sock != -1) {
     struct sockaddr_un addr = {.sun_family = AF_UNIX};
@@ -433,8 +593,9 @@ int main(int argc, char *argv[])
     }
     close(sock);
   }
+#endif
  
   // --- HUGE PAGE CLEANUP ---
-  // munmap(audio_data_writable, HUGE_PAGE_SIZE);
+  // munmap(audio_data_writable, arena_size);
   return 0;
 }
@@ -0,0 +1,202 @@
+#ifndef QUA_STATS_H
+#define QUA_STATS_H
+// Sample-clock measurement (build with -DQUA_STATS).
+// After every SYNC_PTR the hot loop copies (hw_ptr, tstamp) out of the
+// returned status with two plain loads. Both are set by the period interrupt,
+// so each pair is "frames consumed by the DAC" at a CLOCK_MONOTONIC_RAW time.
+// After playback a least-squares fit gives the DAC's effective rate, its
+// drift from TARGET_SAMPLE_RATE in ppm and the interrupt timestamp jitter.
+// The loop also stamps each return from poll (one vDSO clock_gettime), so
+// the report has the wakeup latency distribution: interrupt -> loop awake.
+// The null sink has no interrupt timestamps; there the reference is the
+// timer's own expiry schedule (origin + expirations * period).
+
+#ifdef QUA_STATS
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define QUA_STATS_PATH "/tmp/qua-stats.txt"
+
+#ifdef NULL_SINK
+// The null sink's sync reads the timerfd: the expiration count lands at 0
+#define SYNC_PTR_STATUS_HW_PTR 0
+#define QUA_STATS_CLOCK CLOCK_MONOTONIC // timerfd's clock
+#else
+// Offset of status.hw_ptr in struct snd_pcm_sync_ptr (x86_64); status.tstamp
+// follows it directly. <sound/asound.h> clashes with asoundlib.h, hence no sizeof.
+#define SYNC_PTR_STATUS_HW_PTR 16
+#define QUA_STATS_CLOCK CLOCK_MONOTONIC_RAW // tstamp_type set in setup_alsa
+#endif
+
+typedef struct
+{
+  unsigned long hw_ptr;
+  long sec;
+  long nsec;
+} qua_stats_status_t;
+
+typedef struct
+{
+  qua_stats_status_t status;
+  struct timespec wake;
+} qua_stats_sample_t;
+
+#ifdef NULL_SINK
+// CLOCK_MONOTONIC time of expiration 0 (set by null_sink_start)
+static struct timespec qua_stats_timer_origin;
+#endif
+
+static int compare_double(const void *a, const void *b)
+{
+  const double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Interrupt (or timer expiry) -> return from poll, in us, sorted
+static size_t qua_stats_wake_latency(const qua_stats_sample_t *samples, size_t count, double *out)
+{
+  size_t n = 0;
+#ifdef NULL_SINK
+  unsigned long expirations = 0;
+#endif
+  for (size_t i = 0; i < count; i++)
+  {
+    const qua_stats_sample_t *s = &samples[i];
+    double ref;
+#ifdef NULL_SINK
+    // Last expiry before this wake: the read after the copy consumed it
+    expirations += s->status.hw_ptr;
+    ref = (double)qua_stats_timer_origin.tv_sec + (double)qua_stats_timer_origin.tv_nsec * 1e-9 +
+          (double)expirations * ((double)FRAMES_PER_PERIOD / TARGET_SAMPLE_RATE);
+#else
+    // Only fresh interrupts: a wake with no new hw_ptr has no reference
+    if ((s->status.sec == 0 && s->status.nsec == 0) ||
+        (i > 0 && s->status.hw_ptr == samples[i - 1].status.hw_ptr))
+      continue;
+    ref = (double)s->status.sec + (double)s->status.nsec * 1e-9;
+#endif
+    const double us = ((double)s->wake.tv_sec + (double)s->wake.tv_nsec * 1e-9 - ref) * 1e6;
+    if (us >= 0) // else the interrupt came after the wake (during the copy)
+      out[n++] = us;
+  }
+  qsort(out, n, sizeof(*out), compare_double);
+  return n;
+}
+
+static double percentile(const double *sorted, size_t n, double p)
+{
+  size_t i = (size_t)(p / 100.0 * (double)n);
+  return sorted[i < n ? i : n - 1];
+}
+
+// One slot per loop iteration, so the hot loop never bounds-checks
+static qua_stats_sample_t *qua_stats_alloc(size_t periods)
+{
+  void *p = mmap(NULL, periods * sizeof(qua_stats_sample_t), PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  return p == MAP_FAILED ? NULL : p;
+}
+
+// late_periods: copied before their data was ready (FLAC_RESIDENT), else 0
+static void qua_stats_report(const qua_stats_sample_t *samples, size_t count, unsigned long late_periods)
+{
+  // Keep only fresh interrupts: the same (hw_ptr, tstamp) is returned again
+  // when the loop wakes before the next period elapses
+  size_t n = 0;
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  const qua_stats_sample_t *first = NULL, *prev = NULL;
+  for (size_t i = 0; i < count; i++)
+  {
+    const qua_stats_sample_t *s = &samples[i];
+    if ((s->status.sec == 0 && s->status.nsec == 0) || (prev && s->status.hw_ptr == prev->status.hw_ptr))
+      continue;
+    if (!first)
+      first = s;
+    const double x = (double)(s->status.sec - first->status.sec) + (double)(s->status.nsec - first->status.nsec) * 1e-9;
+    const double y = (double)(s->status.hw_ptr - first->status.hw_ptr);
+    sx += x;
+    sy += y;
+    sxx += x * x;
+    sxy += x * y;
+    n++;
+    prev = s;
+  }
+
+  FILE *f = fopen(QUA_STATS_PATH, "w");
+  if (!f)
+    return;
+
+  // Wakeup latency limit the daemon held on this core ("0" = none)
+  unsigned int cpu = 0;
+  char path[96], qos[32] = "unknown";
+  syscall(SYS_getcpu, &cpu, NULL, NULL);
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/power/pm_qos_resume_latency_us", cpu);
+  FILE *q = fopen(path, "r");
+  if (q)
+  {
+    if (fgets(qos, sizeof(qos), q))
+      qos[strcspn(qos, "\n")] = '\0';
+    fclose(q);
+  }
+  fprintf(f, "cpu=%u\n", cpu);
+  fprintf(f, "wakeup_latency_us=%s\n", qos);
+  fprintf(f, "late_periods=%lu\n", late_periods);
+
+  double *const wake = malloc(count * sizeof(*wake));
+  const size_t wakes = wake ? qua_stats_wake_latency(samples, count, wake) : 0;
+  fprintf(f, "wake_samples=%zu\n", wakes);
+  if (wakes > 0)
+  {
+    fprintf(f, "wake_p50_us=%.1f\n", percentile(wake, wakes, 50));
+    fprintf(f, "wake_p99_us=%.1f\n", percentile(wake, wakes, 99));
+    fprintf(f, "wake_p9999_us=%.1f\n", percentile(wake, wakes, 99.99));
+    fprintf(f, "wake_max_us=%.1f\n", wake[wakes - 1]);
+  }
+  free(wake);
+
+  fprintf(f, "samples=%zu\n", n);
+  const double den = (double)n * sxx - sx * sx;
+  if (n < 3 || den <= 0)
+  {
+    fclose(f);
+    return;
+  }
+
+  // frames = a + rate * t
+  const double rate = ((double)n * sxy - sx * sy) / den;
+  const double a = (sy - rate * sx) / (double)n;
+
+  // Jitter: each interrupt's time offset from the fitted clock line
+  double sum_sq = 0, max_abs = 0, duration = 0;
+  prev = NULL;
+  for (size_t i = 0; i < count; i++)
+  {
+    const qua_stats_sample_t *s = &samples[i];
+    if ((s->status.sec == 0 && s->status.nsec == 0) || (prev && s->status.hw_ptr == prev->status.hw_ptr))
+      continue;
+    const double x = (double)(s->status.sec - first->status.sec) + (double)(s->status.nsec - first->status.nsec) * 1e-9;
+    const double y = (double)(s->status.hw_ptr - first->status.hw_ptr);
+    const double err_us = (x - (y - a) / rate) * 1e6;
+    sum_sq += err_us * err_us;
+    if (fabs(err_us) > max_abs)
+      max_abs = fabs(err_us);
+    duration = x;
+    prev = s;
+  }
+
+  fprintf(f, "duration_s=%.3f\n", duration);
+  fprintf(f, "nominal_hz=%d\n", TARGET_SAMPLE_RATE);
+  fprintf(f, "rate_hz=%.4f\n", rate);
+  fprintf(f, "drift_ppm=%.2f\n", (rate / TARGET_SAMPLE_RATE - 1.0) * 1e6);
+  fprintf(f, "jitter_rms_us=%.1f\n", sqrt(sum_sq / (double)n));
+  fprintf(f, "jitter_max_us=%.1f\n", max_abs);
+  fclose(f);
+}
+#endif
+
+#endif // QUA_STATS_H
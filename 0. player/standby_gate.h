@@ -0,0 +1,28 @@
+#ifndef STANDBY_GATE_H
+#define STANDBY_GATE_H
+// Warm standby (daemon PLAYER_STANDBY): the daemon starts the next track's
+// player while the current one still plays, with an eventfd as an extra
+// argument. The track is loaded and locked first, then the player parks
+// here until the daemon releases it, so a transition costs the PCM open and
+// the two-period prefill only. The launcher starts a standby at SCHED_IDLE;
+// the daemon raises it to SCHED_FIFO before the release.
+
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+
+// 0 once released; -1 if the gate is gone (the daemon kills a standby it
+// no longer wants, so this is not expected in practice)
+static int standby_wait(int gate_fd)
+{
+  uint64_t value;
+  ssize_t n;
+  do
+    n = read(gate_fd, &value, sizeof(value));
+  while (n == -1 && errno == EINTR);
+  close(gate_fd);
+  DEBUG_PRINT("Standby: released (%zd)\n", n);
+  return n == sizeof(value) ? 0 : -1;
+}
+
+#endif // STANDBY_GATE_H
@@ -21,9 +21,13 @@ typedef struct WavHeader_s
   uint16_t sample_alignment;
   uint16_t bit_depth;
   char data_header[4];
-  uint32_t data_bytes;
+  uint64_t data_bytes; // from ds64 for RF64/BW64
 } WavHeader;
 
+// RF64/BW64 (EBU Tech 3306/ITU-R BS.2088): sizes past 4GB live in a ds64
+// chunk right after WAVE; the 32-bit RIFF and data sizes read 0xFFFFFFFF
+#define WAV_SIZE_IN_DS64 0xFFFFFFFFu
+
 
 static off_t read_wav_header(int fd, WavHeader *header)
 {
@@ -35,7 +39,9 @@ static off_t read_wav_header(int fd, WavHeader *header)
   CHECK_READ(bytes_read, 12, "Failed to read WAV header");
 
 #ifdef DEBUG
-  if (unlikely(strncmp((char *)basic_header, "RIFF", 4) != 0 ||
+  if (unlikely((strncmp((char *)basic_header, "RIFF", 4) != 0 &&
+                strncmp((char *)basic_header, "RF64", 4) != 0 &&
+                strncmp((char *)basic_header, "BW64", 4) != 0) ||
                strncmp((char *)basic_header + 8, "WAVE", 4) != 0))
   {
     fprintf(stderr, "Invalid WAV file format\n");
@@ -51,6 +57,7 @@ static off_t read_wav_header(int fd, WavHeader *header)
   int fmt_chunk_found = 0;
   int data_chunk_found = 0;
   off_t data_offset = 0;
+  uint64_t ds64_data_bytes = 0;
 
   while (!data_chunk_found)
   {
@@ -65,8 +72,27 @@ static off_t read_wav_header(int fd, WavHeader *header)
     bytes_read = read(fd, &chunk_size, 4);
     CHECK_READ(bytes_read, 4, "Couldn't read chunk size");
 
+    // --- 'ds64' Chunk Processing (RF64/BW64) ---
+    if (strncmp(chunk_id, "ds64", 4) == 0)
+    {
+      // riffSize, dataSize, sampleCount (all 64-bit), then an optional table.
+      // Checked in every build: a shorter chunk would wrap the skip below.
+      if (unlikely(chunk_size < 24))
+      {
+#ifdef DEBUG
+        fprintf(stderr, "ds64 chunk too small\n");
+#endif
+        return -1;
+      }
+
+      uint8_t ds64_data[24];
+      bytes_read = read(fd, ds64_data, 24);
+      CHECK_READ(bytes_read, 24, "Failed to read ds64 chunk data");
+      memcpy(&ds64_data_bytes, ds64_data + 8, 8);
+      lseek(fd, chunk_size - 24 + (chunk_size & 1), SEEK_CUR);
+    }
     // --- 'fmt ' Chunk Processing ---
-    if (strncmp(chunk_id, "fmt ", 4) == 0)
+    else if (strncmp(chunk_id, "fmt ", 4) == 0)
     {
       memcpy(header->fmt_header, chunk_id, 4);
       header->fmt_chunk_size = chunk_size;
@@ -117,7 +143,7 @@ static off_t read_wav_header(int fd, WavHeader *header)
     else if (strncmp(chunk_id, "data", 4) == 0)
     {
       memcpy(header->data_header, chunk_id, 4);
-      header->data_bytes = chunk_size;
+      header->data_bytes = chunk_size == WAV_SIZE_IN_DS64 ? ds64_data_bytes : chunk_size;
       data_chunk_found = 1;
       data_offset = lseek(fd, 0, SEEK_CUR);
       break;
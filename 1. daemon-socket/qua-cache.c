@@ -1,87 +1,285 @@
 #include "qua-cache.h"
+#include "qua-config.h"
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
+// In-memory index of the cache directory, built once by cache_init() and
+// kept current by the daemon (insert/touch/evict). Hits cost no syscalls;
+// eviction walks an intrusive LRU list and stops once under the low-water
+// mark, so it is O(evicted) rather than a scandir + stat of everything.
+#define INDEX_BUCKETS 1024
+
+typedef struct cache_entry {
+    struct cache_entry *hnext;          // hash chain
+    struct cache_entry *prev, *next;    // LRU list, least recent first
+    off_t size;
+    time_t last_use;
+    int pinned;
+    char name[];
+} cache_entry_t;
+
+static cache_entry_t *buckets[INDEX_BUCKETS];
+static uint64_t policy_hash;
+static cache_entry_t *lru_head, *lru_tail;
+static long long total_bytes;
+
+// Entries are qua-<key>.<ext>; anything with a second dot is work
+// in progress (.part, .tmp, the CACHE_FLAC scratch .wav)
+static int is_entry(const char *name) {
+    return name[0] != '.' && strchr(name, '.') == strrchr(name, '.');
+}
+
+static int filter_entry(const struct dirent *e) { return is_entry(e->d_name); }
+
+static const char *entry_name(const char *cache_path) {
+    const char *slash = strrchr(cache_path, '/');
+    return slash ? slash + 1 : cache_path;
+}
+
+// FNV-1a
+static uint64_t fnv1a(const void *data, size_t len, uint64_t h) {
+    const unsigned char *p = data;
+    while (len--)
+        h = (h ^ *p++) * 1099511628211ull;
+    return h;
+}
+
+#define FNV_BASIS 14695981039346656037ull
+
+static cache_entry_t **bucket(const char *name) {
+    return &buckets[fnv1a(name, strlen(name), FNV_BASIS) & (INDEX_BUCKETS - 1)];
+}
+
+static cache_entry_t *lookup(const char *cache_path) {
+    const char *name = entry_name(cache_path);
+    for (cache_entry_t *e = *bucket(name); e; e = e->hnext)
+        if (strcmp(e->name, name) == 0)
+            return e;
+    return NULL;
+}
+
+static void lru_unlink(cache_entry_t *e) {
+    if (e->prev) e->prev->next = e->next; else lru_head = e->next;
+    if (e->next) e->next->prev = e->prev; else lru_tail = e->prev;
+}
+
+static void lru_append(cache_entry_t *e) {
+    e->prev = lru_tail;
+    e->next = NULL;
+    if (lru_tail) lru_tail->next = e; else lru_head = e;
+    lru_tail = e;
+}
+
+static void index_add(const char *name, off_t size, time_t last_use) {
+    size_t len = strlen(name) + 1;
+    cache_entry_t *e = malloc(sizeof(*e) + len);
+    if (!e) return;
+    memcpy(e->name, name, len);
+    e->size = size;
+    e->last_use = last_use;
+    e->pinned = 0;
+    cache_entry_t **b = bucket(name);
+    e->hnext = *b;
+    *b = e;
+    lru_append(e);
+    total_bytes += size;
+}
+
+static void index_remove(cache_entry_t *e) {
+    cache_entry_t **p = bucket(e->name);
+    while (*p != e)
+        p = &(*p)->hnext;
+    *p = e->hnext;
+    lru_unlink(e);
+    total_bytes -= e->size;
+    free(e);
+}
+
 typedef struct {
     char name[256];
     time_t atime;
     off_t size;
-} cache_entry_t;
+} scan_entry_t;
 
 static int compare_atime(const void *a, const void *b) {
-    const cache_entry_t *ea = (const cache_entry_t *)a;
-    const cache_entry_t *eb = (const cache_entry_t *)b;
+    const scan_entry_t *ea = (const scan_entry_t *)a;
+    const scan_entry_t *eb = (const scan_entry_t *)b;
     if (ea->atime < eb->atime) return -1;
     if (ea->atime > eb->atime) return 1;
     return 0;
 }
 
+// The one full scan: existing entries join the LRU list in atime order
 void cache_init(void) {
     mkdir(CACHE_DIR, 0755);
+
+    struct dirent **namelist;
+    int n = scandir(CACHE_DIR, &namelist, filter_entry, NULL);
+    if (n < 0) return;
+
+    scan_entry_t *entries = malloc((n ? n : 1) * sizeof(scan_entry_t));
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        char p[PATH_MAX];
+        snprintf(p, sizeof(p), "%s/%s", CACHE_DIR, namelist[i]->d_name);
+        struct stat s;
+        if (entries && stat(p, &s) == 0 && S_ISREG(s.st_mode)) {
+            snprintf(entries[count].name, sizeof(entries[count].name), "%s", namelist[i]->d_name);
+            entries[count].atime = s.st_atime;
+            entries[count].size = s.st_size;
+            count++;
+        }
+        free(namelist[i]);
+    }
+    free(namelist);
+
+    if (entries) {
+        qsort(entries, count, sizeof(scan_entry_t), compare_atime);
+        for (int i = 0; i < count; i++)
+            index_add(entries[i].name, entries[i].size, entries[i].atime);
+        free(entries);
+    }
+}
+
+void cache_sweep_partial(void) {
+    DIR *dir = opendir(CACHE_DIR);
+    if (!dir) return;
+
+    struct dirent *e;
+    while ((e = readdir(dir)))
+        if (e->d_name[0] != '.' && !is_entry(e->d_name))
+            unlinkat(dirfd(dir), e->d_name, 0);
+    closedir(dir);
+}
+
+void cache_set_policy(const char *policy) {
+    policy_hash = fnv1a(policy, strlen(policy), FNV_BASIS);
+}
+
+// CACHE_KEY_CONTENT: size plus head, middle and tail of the file, so a
+// renamed or copied file keeps its key. A same-size edit that misses all
+// three samples goes unnoticed; the identity key below has no such gap.
+#define CONTENT_SAMPLE (64 * 1024)
+
+static int content_hash(const char *filepath, off_t size, uint64_t *hash) {
+    int fd = open(filepath, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+    static unsigned char buf[CONTENT_SAMPLE];
+    const off_t at[3] = {0, size / 2, size > CONTENT_SAMPLE ? size - CONTENT_SAMPLE : 0};
+    uint64_t h = fnv1a(&size, sizeof(size), FNV_BASIS);
+    for (int i = 0; i < 3; i++) {
+        ssize_t n = pread(fd, buf, sizeof(buf), at[i]);
+        if (n < 0) {
+            close(fd);
+            return -1;
+        }
+        h = fnv1a(buf, n, h);
+    }
+    close(fd);
+    *hash = h;
+    return 0;
 }
 
 int cache_generate_path(const char *filepath, char *cache_path, size_t size) {
     struct stat st;
     if (stat(filepath, &st) != 0)
         return -1;
-    snprintf(cache_path, size, "%s/qua-%lx-%lx.wav", CACHE_DIR,
-             (unsigned long)st.st_ino, (unsigned long)st.st_mtime);
+    const char *ext = CACHE_FLAC ? "flac" : "wav";
+    if (CACHE_KEY_CONTENT) {
+        uint64_t hash;
+        if (content_hash(filepath, st.st_size, &hash) != 0)
+            return -1;
+        snprintf(cache_path, size, "%s/qua-c%016llx-%llx-%016llx.%s", CACHE_DIR,
+                 (unsigned long long)hash, (unsigned long long)st.st_size,
+                 (unsigned long long)policy_hash, ext);
+        return 0;
+    }
+    // Identity: device, inode, size and mtime to the nanosecond
+    unsigned long long mtime_ns = st.st_mtim.tv_sec * 1000000000ull + st.st_mtim.tv_nsec;
+    snprintf(cache_path, size, "%s/qua-%llx-%llx-%llx-%llx-%016llx.%s", CACHE_DIR,
+             (unsigned long long)st.st_dev, (unsigned long long)st.st_ino,
+             (unsigned long long)st.st_size, mtime_ns, (unsigned long long)policy_hash, ext);
     return 0;
 }
 
 int cache_exists(const char *cache_path) {
-    struct stat st;
-    return (stat(cache_path, &st) == 0 && S_ISREG(st.st_mode));
+    return lookup(cache_path) != NULL;
 }
 
-void cache_manage_size(void) {
-    struct dirent **namelist;
-    int n = scandir(CACHE_DIR, &namelist, NULL, NULL);
-    if (n < 0) return;
-
-    cache_entry_t *entries = malloc(n * sizeof(cache_entry_t));
-    if (!entries) {
-        for (int i = 0; i < n; i++) free(namelist[i]);
-        free(namelist);
+void cache_insert(const char *cache_path) {
+    struct stat st;
+    cache_entry_t *e = lookup(cache_path);
+    if (stat(cache_path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        if (e) index_remove(e);
+        return;
+    }
+    if (e) {
+        total_bytes += st.st_size - e->size;
+        e->size = st.st_size;
+        cache_touch(cache_path);
         return;
     }
+    index_add(entry_name(cache_path), st.st_size, time(NULL));
+}
 
-    int count = 0;
-    long long total = 0;
+void cache_touch(const char *cache_path) {
+    cache_entry_t *e = lookup(cache_path);
+    if (!e) return;
+    e->last_use = time(NULL);
+    lru_unlink(e);
+    lru_append(e);
+}
 
-    for (int i = 0; i < n; i++) {
-        if (namelist[i]->d_name[0] == '.') continue;
-        char p[PATH_MAX];
-        snprintf(p, sizeof(p), "%s/%s", CACHE_DIR, namelist[i]->d_name);
-        struct stat s;
-        if (stat(p, &s) == 0 && S_ISREG(s.st_mode)) {
-            strncpy(entries[count].name, namelist[i]->d_name, sizeof(entries[count].name) - 1);
-            entries[count].name[sizeof(entries[count].name) - 1] = '\0';
-            entries[count].atime = s.st_atime;
-            entries[count].size = s.st_size;
-            total += s.st_size;
-            count++;
-        }
+void cache_pin(const char *cache_path, int pinned) {
+    cache_entry_t *e = lookup(cache_path);
+    if (e) e->pinned = pinned;
+}
+
+void cache_remove(const char *cache_path) {
+    cache_entry_t *e = lookup(cache_path);
+    if (e) index_remove(e);
+}
+
+void cache_clear(void) {
+    DIR *dir = opendir(CACHE_DIR);
+    if (dir) {
+        struct dirent *e;
+        while ((e = readdir(dir)))
+            if (is_entry(e->d_name))
+                unlinkat(dirfd(dir), e->d_name, 0);
+        closedir(dir);
     }
+    while (lru_head)
+        index_remove(lru_head);
+}
+
+void cache_manage_size(void) {
+    if (total_bytes <= (long long)CACHE_MAX_SIZE) return;
 
-    // Sort by atime and delete until under threshold
-    if (total > CACHE_MAX_SIZE) {
-        qsort(entries, count, sizeof(cache_entry_t), compare_atime);
-        for (int i = 0; i < count && total > (long long)(CACHE_MAX_SIZE * 0.7); i++) {
+    // Least recently used first, until under the low-water mark
+    cache_entry_t *e = lru_head;
+    while (e && total_bytes > (long long)CACHE_LOW_WATER) {
+        cache_entry_t *next = e->next;
+        if (!e->pinned) {
             char p[PATH_MAX];
-            snprintf(p, sizeof(p), "%s/%s", CACHE_DIR, entries[i].name);
+            snprintf(p, sizeof(p), "%s/%s", CACHE_DIR, e->name);
             unlink(p);
-            total -= entries[i].size;
+            index_remove(e);
         }
+        e = next;
     }
+}
 
-    free(entries);
-    for (int i = 0; i < n; i++) free(namelist[i]);
-    free(namelist);
+long long cache_total_size(void) {
+    return total_bytes;
 }
@@ -5,18 +5,44 @@
 
 #define CACHE_DIR "/dev/shm/qua-cache"
 #define CACHE_MAX_SIZE (2ULL * 1024 * 1024 * 1024)
+#define CACHE_LOW_WATER (CACHE_MAX_SIZE / 10 * 7)  // eviction stops here
 
-// Initialize cache directory (create if needed)
+// Initialize cache directory (create if needed) and index its entries
 void cache_init(void);
 
-// Generate cache path from source file (inode + mtime)
-// Returns 0 on success, -1 on failure
+// Remove work in progress left by a previous daemon (call with the lock held)
+void cache_sweep_partial(void);
+
+// Fold the converter's version and format policy into every key
+void cache_set_policy(const char *policy);
+
+// Generate cache path from source file: device, inode, size, ns mtime and
+// the policy; or with CACHE_KEY_CONTENT a sampled content hash, size and
+// the policy. Returns 0 on success, -1 on failure
 int cache_generate_path(const char *filepath, char *cache_path, size_t size);
 
-// Check if cache file exists
+// Check if cache entry exists (index lookup, no syscalls)
 int cache_exists(const char *cache_path);
 
-// Manage cache size - delete old entries if over limit
+// Index a completed entry (or update its size) as most recently used
+void cache_insert(const char *cache_path);
+
+// Mark an entry used: moves it to the back of the LRU list
+void cache_touch(const char *cache_path);
+
+// Pinned entries are never evicted (the one playing)
+void cache_pin(const char *cache_path, int pinned);
+
+// Drop an entry found missing on disk from the index
+void cache_remove(const char *cache_path);
+
+// Delete every entry and empty the index; work in progress is left to finish
+void cache_clear(void);
+
+// Manage cache size - evict least recently used entries if over limit
 void cache_manage_size(void);
 
+// Total bytes of cache entries
+long long cache_total_size(void);
+
 #endif
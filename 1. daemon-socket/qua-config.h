@@ -5,8 +5,29 @@
 #define SOCKET_PATH		"/tmp/qua-socket.sock"
 #define LOCK_PATH		"/tmp/qua-socket-daemon.lock"
 #define BUF_SIZE		4096
-#define COALESCE_TIMEOUT_MS	20
-#define LAUNCHER_CORE_ID	4
+#define COALESCE_TIMEOUT_MS	20	/* next/prev closer than this form one burst */
+#define LAUNCHER_CORE_ID	4	/* Fallback when the topology cannot be read */
+#define LAUNCHER_CORE_AUTO	1	/* Pick the core nearest the DAC's controller IRQ */
+#define PLAYBACK_DEVICE		"hw:0,0"
+#define LAUNCHER_ISOLATE	0	/* Isolated cgroup v2 cpuset partition for the audio core (needs root) */
+#define WAKEUP_LATENCY_US	""	/* Audio core pm_qos_resume_latency_us while playing (needs root)
+					   "" = leave alone, "n/a" = no C-states, "N" = exit latency <= N us */
+#define IRQ_STEER		0	/* DAC controller IRQ while playing (needs root):
+					   0 = leave alone, 1 = audio core, 2 = its SMT sibling */
+#define CONVERT_MEMFD		0	/* Cache miss: converter output goes to the player in a sealed memfd
+					   0 = via the cache file, 1 = memfd, 2 = memfd on huge pages (MFD_HUGETLB) */
+#define CACHE_FLAC		0	/* Cache entries as FLAC, for players built with -DFLAC_RESIDENT
+					   (needs flac >= 1.4 for 32-bit PCM; overrides CONVERT_MEMFD) */
+#define FLAC_ENCODE_CMD		"flac"
+#define CACHE_KEY_CONTENT	0	/* Cache key from a sampled content hash instead of the file's identity:
+					   renamed/copied files still hit, costs 192 KiB of reads per lookup */
+#define PREFETCH_AHEAD		3	/* Tracks after the current one kept converted */
+#define PREFETCH_BEHIND		1	/* Tracks before it */
+#define PREFETCH_JOBS		0	/* Concurrent prefetch conversions (max 8), 0 = online CPUs - 2 */
+#define PLAYER_STANDBY		1	/* Start the next cached track's player early, parked until the
+					   current one ends (needs hugepages for two arenas) */
 #define RESPOND_EARLY		1
+#define PADDING_HEAD_MS		0	/* Virtual silence before track (player-side, no RAM) */
+#define PADDING_TAIL_MS		0	/* Virtual silence after track */
 
 #endif
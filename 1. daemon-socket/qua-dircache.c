@@ -0,0 +1,158 @@
+#include "qua-dircache.h"
+
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+// Sorted audio listings of recently used directories. A listing stays
+// valid until inotify reports an entry created, deleted or renamed in its
+// directory, so next/prev is an array step with no filesystem access.
+#define DIRCACHE_SLOTS 8
+
+typedef struct {
+    char dir[PATH_MAX];             // "" = free slot
+    int wd;                         // inotify watch, -1 = not cached
+    int valid;
+    int count;
+    struct dirent **list;           // alphasort order, as scandir gave it
+    int cur;                        // index of the last track looked up
+    unsigned long last_use;
+} listing_t;
+
+static listing_t listings[DIRCACHE_SLOTS];
+static int inotify_fd = -1;
+static unsigned long use_clock;
+
+static int is_audio(const char *name) {
+    const char *dot = strrchr(name, '.');
+    if (!dot || dot == name || *(dot + 1) == '\0')
+        return 0;
+    dot++;
+    switch (dot[0]) {
+    case 'a': return strcmp(dot, "ape") == 0 || strcmp(dot, "aiff") == 0 || strcmp(dot, "aif") == 0;
+    case 'f': return strcmp(dot, "flac") == 0;
+    case 'm': return strcmp(dot, "mp3") == 0 || strcmp(dot, "m4a") == 0;
+    case 'o': return strcmp(dot, "opus") == 0 || strcmp(dot, "ogg") == 0;
+    case 'w': return strcmp(dot, "wv") == 0 || strcmp(dot, "wav") == 0;
+    default:  return 0;
+    }
+}
+
+static int filter_audio(const struct dirent *e) { return is_audio(e->d_name); }
+
+static void listing_drop(listing_t *l) {
+    for (int i = 0; i < l->count; i++) free(l->list[i]);
+    free(l->list);
+    l->list = NULL;
+    l->count = 0;
+    l->valid = 0;
+}
+
+int dircache_init(void) {
+    for (int i = 0; i < DIRCACHE_SLOTS; i++)
+        listings[i].wd = -1;
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    return inotify_fd;
+}
+
+void dircache_handle_events(void) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+    while ((n = read(inotify_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            p += sizeof(*ev) + ev->len;
+            for (int i = 0; i < DIRCACHE_SLOTS; i++) {
+                if (listings[i].wd != ev->wd) continue;
+                // Only audio names change the listing (or the directory itself going)
+                if (ev->len && !(ev->mask & IN_ISDIR) && !is_audio(ev->name)) continue;
+                listing_drop(&listings[i]);
+                if (ev->mask & IN_IGNORED)
+                    listings[i].wd = -1;
+            }
+        }
+    }
+}
+
+// The slot for dir, (re)scanned if needed; NULL if it cannot be listed
+static listing_t *listing_get(const char *dir) {
+    listing_t *l = NULL, *victim = &listings[0];
+    for (int i = 0; i < DIRCACHE_SLOTS; i++) {
+        if (listings[i].dir[0] && strcmp(listings[i].dir, dir) == 0) {
+            l = &listings[i];
+            break;
+        }
+        if (listings[i].last_use < victim->last_use)
+            victim = &listings[i];
+    }
+
+    if (!l) {
+        l = victim;
+        listing_drop(l);
+        if (l->wd != -1)
+            inotify_rm_watch(inotify_fd, l->wd);
+        l->wd = -1;
+        snprintf(l->dir, sizeof(l->dir), "%s", dir);
+    }
+    l->last_use = ++use_clock;
+
+    // Unwatched directories are rescanned every time
+    if (l->valid && l->wd != -1)
+        return l;
+
+    listing_drop(l);
+    if (inotify_fd != -1 && l->wd == -1)
+        l->wd = inotify_add_watch(inotify_fd, dir, IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                  IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+    int n = scandir(dir, &l->list, filter_audio, alphasort);
+    if (n <= 0) {
+        if (n == 0) free(l->list);
+        l->list = NULL;
+        return NULL;
+    }
+    l->count = n;
+    l->cur = 0;
+    l->valid = 1;
+    return l;
+}
+
+static int compare_name(const void *key, const void *entry) {
+    return strcoll(key, (*(struct dirent *const *)entry)->d_name);
+}
+
+int dircache_next(const char *current, int offset, char *result, size_t size) {
+    if (!current || !current[0]) return 1;
+
+    const char *slash = strrchr(current, '/');
+    char dir[PATH_MAX];
+    if (slash)
+        snprintf(dir, sizeof(dir), "%.*s", slash == current ? 1 : (int)(slash - current), current);
+    else
+        snprintf(dir, sizeof(dir), ".");
+    const char *name = slash ? slash + 1 : current;
+
+    listing_t *l = listing_get(dir);
+    if (!l) return 1;
+
+    // Usually still where the last lookup left it
+    int cur = -1;
+    if (strcmp(l->list[l->cur]->d_name, name) == 0) {
+        cur = l->cur;
+    } else {
+        struct dirent **hit = bsearch(name, l->list, l->count, sizeof(*l->list), compare_name);
+        if (hit) cur = hit - l->list;
+    }
+
+    // The hint follows the track looked up, not the result: prefetch asks
+    // about +1, -1, +2... of the same current track
+    if (cur != -1) l->cur = cur;
+    int next = (cur == -1) ? 0 : (cur + offset) % l->count;
+    if (next < 0) next += l->count;
+
+    snprintf(result, size, "%s%s%s", strcmp(dir, "/") == 0 ? "" : dir, "/", l->list[next]->d_name);
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef QUA_DIRCACHE_H
+#define QUA_DIRCACHE_H
+
+#include <stddef.h>
+
+// Start watching directories; returns the inotify fd for the event loop,
+// or -1 (listings are then rescanned on every lookup)
+int dircache_init(void);
+
+// Drain the inotify fd, invalidating the listings of changed directories
+void dircache_handle_events(void);
+
+// Track `offset` steps from current in its directory's sorted audio listing,
+// wrapping; the first track if current is not in it.
+// Returns 0 on success, 1 if there is nothing to step to
+int dircache_next(const char *current, int offset, char *result, size_t size);
+
+#endif
@@ -1,27 +1,506 @@
+#include <ctype.h>
 #include <dirent.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/personality.h>
 #include <sys/prctl.h>
 #include <sys/resource.h>
+#include <sys/stat.h>
 #include <linux/prctl.h>
 #include <unistd.h>
 
 #include "qua-launcher.h"
 
+#define LAUNCHER_MAX_IRQS	16
+
+/* Read the first line of a sysfs/procfs file, newline stripped */
+static int read_line(const char *path, char *buf, size_t len)
+{
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+	ssize_t n = read(fd, buf, len - 1);
+	close(fd);
+	if (n <= 0)
+		return -1;
+	buf[n] = '\0';
+	buf[strcspn(buf, "\n")] = '\0';
+	return 0;
+}
+
+/* Parse a kernel cpulist ("0-3,8,10-11") */
+static void parse_cpulist(const char *s, cpu_set_t *set)
+{
+	CPU_ZERO(set);
+	while (*s) {
+		char *end;
+		long a = strtol(s, &end, 10), b = a;
+		if (end == s)
+			break;
+		if (*end == '-')
+			b = strtol(end + 1, &end, 10);
+		for (long c = a; c <= b && c < CPU_SETSIZE; c++)
+			CPU_SET(c, set);
+		if (*end != ',')
+			break;
+		s = end + 1;
+	}
+}
+
+static int read_cpulist(const char *path, cpu_set_t *set)
+{
+	char buf[1024];
+	if (read_line(path, buf, sizeof(buf)) != 0)
+		return -1;
+	parse_cpulist(buf, set);
+	return CPU_COUNT(set) ? 0 : -1;
+}
+
+static int first_cpu(const cpu_set_t *set)
+{
+	for (int c = 0; c < CPU_SETSIZE; c++)
+		if (CPU_ISSET(c, set))
+			return c;
+	return -1;
+}
+
+/* "hw:1,0", "hw:CARD=DAC,DEV=0" or "hw:DAC" -> ALSA card index */
+static int device_card(const char *device)
+{
+	const char *p = strchr(device, ':');
+	if (!p)
+		return -1;
+	p++;
+	if (strncmp(p, "CARD=", 5) == 0)
+		p += 5;
+
+	char id[64];
+	size_t n = strcspn(p, ",");
+	if (n == 0 || n >= sizeof(id))
+		return -1;
+	memcpy(id, p, n);
+	id[n] = '\0';
+	if (isdigit((unsigned char)id[0]))
+		return atoi(id);
+
+	/* /proc/asound/<id> is a symlink to cardN */
+	char path[96], link[32];
+	snprintf(path, sizeof(path), "/proc/asound/%s", id);
+	ssize_t len = readlink(path, link, sizeof(link) - 1);
+	if (len <= 0)
+		return -1;
+	link[len] = '\0';
+	return strncmp(link, "card", 4) == 0 ? atoi(link + 4) : -1;
+}
+
+/*
+ * Find the PCI function the card hangs off (USB host controller, HDA...):
+ * the first ancestor of its sysfs device with a local_cpulist. Fills @irqs
+ * with its interrupts, lowest first (MSI(-X) vectors, else INTx; xHCI
+ * interrupter 0 is the lowest vector) and @local with the node's CPUs.
+ * Returns the number of interrupts, or -1.
+ */
+static int card_irqs(int card, cpu_set_t *local, int *irqs, int max)
+{
+	char path[PATH_MAX + 32], dev[PATH_MAX], buf[64];
+
+	snprintf(path, sizeof(path), "/sys/class/sound/card%d/device", card);
+	if (!realpath(path, dev))
+		return -1;
+	for (;;) {
+		snprintf(path, sizeof(path), "%s/local_cpulist", dev);
+		if (read_cpulist(path, local) == 0)
+			break;
+		char *slash = strrchr(dev, '/');
+		if (!slash || slash == dev)
+			return -1;
+		*slash = '\0';
+	}
+
+	int count = 0;
+	snprintf(path, sizeof(path), "%s/msi_irqs", dev);
+	DIR *dir = opendir(path);
+	if (dir) {
+		struct dirent *entry;
+		while ((entry = readdir(dir)) != NULL && count < max) {
+			int n = atoi(entry->d_name);
+			if (n <= 0)
+				continue;
+			/* insertion sort, readdir order is arbitrary */
+			int i = count++;
+			for (; i > 0 && irqs[i - 1] > n; i--)
+				irqs[i] = irqs[i - 1];
+			irqs[i] = n;
+		}
+		closedir(dir);
+	}
+	if (count == 0) {
+		snprintf(path, sizeof(path), "%s/irq", dev);
+		if (read_line(path, buf, sizeof(buf)) == 0 && atoi(buf) > 0)
+			irqs[count++] = atoi(buf);
+	}
+	return count;
+}
+
+/* CPU the card's (first) controller interrupt is delivered to, or -1 */
+static int card_irq_cpu(int card, cpu_set_t *local)
+{
+	char path[64];
+	int irqs[LAUNCHER_MAX_IRQS];
+
+	if (card_irqs(card, local, irqs, LAUNCHER_MAX_IRQS) <= 0)
+		return -1;
+
+	cpu_set_t eff;
+	snprintf(path, sizeof(path), "/proc/irq/%d/effective_affinity_list", irqs[0]);
+	if (read_cpulist(path, &eff) != 0)
+		return -1;
+	return first_cpu(&eff);
+}
+
+static int is_primary_thread(int cpu)
+{
+	char path[96];
+	cpu_set_t sib;
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+	return read_cpulist(path, &sib) != 0 || first_cpu(&sib) == cpu;
+}
+
+int launcher_pick_core(const char *device, int fallback_core)
+{
+	cpu_set_t local, l3, smt;
+	char path[96];
+
+	int card = device_card(device);
+	if (card < 0)
+		return fallback_core;
+
+	/* Anchor on the interrupt CPU, unless it was routed off-node */
+	CPU_ZERO(&local);
+	int anchor = card_irq_cpu(card, &local);
+	if (anchor < 0 || !CPU_ISSET(anchor, &local))
+		anchor = first_cpu(&local);
+	if (anchor < 0)
+		return fallback_core;
+
+	/* Candidate domain: the anchor's L3 (CCX), else its NUMA node */
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/cpu/cpu%d/cache/index3/shared_cpu_list", anchor);
+	if (read_cpulist(path, &l3) != 0)
+		l3 = local;
+
+	/* Leave the interrupt's physical core to the interrupt */
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", anchor);
+	if (read_cpulist(path, &smt) != 0) {
+		CPU_ZERO(&smt);
+		CPU_SET(anchor, &smt);
+	}
+
+	/* Keep the configured core when it is already in the right domain */
+	if (fallback_core >= 0 && fallback_core < CPU_SETSIZE &&
+	    CPU_ISSET(fallback_core, &l3) && !CPU_ISSET(fallback_core, &smt))
+		return fallback_core;
+
+	for (int c = CPU_SETSIZE - 1; c >= 0; c--) {
+		if (CPU_ISSET(c, &l3) && !CPU_ISSET(c, &smt) && is_primary_thread(c))
+			return c;
+	}
+	return fallback_core;
+}
+
+/* CPUs of @cpu's NUMA node, from its nodeN link in sysfs */
+static int node_cpus(int cpu, cpu_set_t *set)
+{
+	char path[96];
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+	DIR *dir = opendir(path);
+	if (!dir)
+		return -1;
+	struct dirent *e;
+	int node = -1;
+	while ((e = readdir(dir)) && node < 0)
+		if (strncmp(e->d_name, "node", 4) == 0 && isdigit((unsigned char)e->d_name[4]))
+			node = atoi(e->d_name + 4);
+	closedir(dir);
+	if (node < 0)
+		return -1;
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+	return read_cpulist(path, set);
+}
+
+/*
+ * cgroup v2 cpuset isolation.
+ *
+ * QUA_CGROUP becomes an isolated partition holding only the audio core:
+ * its CPU leaves the root's effective cpuset and the scheduler domains, so
+ * nothing else is placed or balanced onto it. No isolcpus= boot option.
+ * With a FLAC decoder thread in the player, a second CPU goes in for it:
+ * the player joins before exec, so the thread cannot leave the partition.
+ */
+#define QUA_CGROUP_ROOT	"/sys/fs/cgroup"
+#define QUA_CGROUP	QUA_CGROUP_ROOT "/qua-audio"
+
+static int cpuset_enabled_by_us;
+
+static int write_str(const char *path, const char *s)
+{
+	int fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+	ssize_t len = (ssize_t)strlen(s);
+	int ret = write(fd, s, len) == len ? 0 : -1;
+	close(fd);
+	return ret;
+}
+
+/*
+ * The decoder's CPU: the lowest primary thread of the audio core's L3, else
+ * of its NUMA node, outside the audio core's physical core. Topology only,
+ * so repeated calls agree while the partition already holds it. -1 if none.
+ */
+static int decoder_cpu(int core_id)
+{
+	char path[96];
+	cpu_set_t set, smt;
+
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", core_id);
+	if (read_cpulist(path, &smt) != 0)
+		CPU_ZERO(&smt);
+	CPU_SET(core_id, &smt);
+
+	for (int pass = 0; pass < 2; pass++) {
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu%d/cache/index3/shared_cpu_list", core_id);
+		if ((pass ? node_cpus(core_id, &set) : read_cpulist(path, &set)) != 0)
+			continue;
+		for (int c = 0; c < CPU_SETSIZE; c++)
+			if (CPU_ISSET(c, &set) && !CPU_ISSET(c, &smt) && is_primary_thread(c))
+				return c;
+	}
+	return -1;
+}
+
+int launcher_isolate(int core_id, int decoder)
+{
+	char buf[256];
+
+	/* cpuset has to be enabled for the root's children */
+	if (read_line(QUA_CGROUP_ROOT "/cgroup.subtree_control", buf, sizeof(buf)) != 0)
+		buf[0] = '\0';
+	if (!strstr(buf, "cpuset")) {
+		if (write_str(QUA_CGROUP_ROOT "/cgroup.subtree_control", "+cpuset") != 0)
+			return -1;
+		cpuset_enabled_by_us = 1;
+	}
+
+	if (mkdir(QUA_CGROUP, 0755) != 0 && errno != EEXIST)
+		goto fail;
+
+	int extra = decoder ? decoder_cpu(core_id) : -1;
+	if (extra >= 0)
+		snprintf(buf, sizeof(buf), "%d,%d", core_id, extra);
+	else
+		snprintf(buf, sizeof(buf), "%d", core_id);
+	if (write_str(QUA_CGROUP "/cpuset.cpus", buf) != 0)
+		goto fail;
+	/* 6.7+: claim the CPU explicitly; older kernels take it from cpuset.cpus */
+	write_str(QUA_CGROUP "/cpuset.cpus.exclusive", buf);
+	if (write_str(QUA_CGROUP "/cpuset.cpus.partition", "isolated") != 0)
+		goto fail;
+
+	/* A rejected partition shows up on read ("isolated invalid (...)") */
+	if (read_line(QUA_CGROUP "/cpuset.cpus.partition", buf, sizeof(buf)) != 0 ||
+	    strcmp(buf, "isolated") != 0)
+		goto fail;
+	return 0;
+
+fail:
+	launcher_isolate_release();
+	return -1;
+}
+
+int launcher_isolate_join(pid_t pid)
+{
+	char buf[16];
+
+	snprintf(buf, sizeof(buf), "%d", (int)pid);
+	return write_str(QUA_CGROUP "/cgroup.procs", buf);
+}
+
+void launcher_isolate_release(void)
+{
+	/* Hands the CPU back even if the group cannot be removed yet */
+	write_str(QUA_CGROUP "/cpuset.cpus.partition", "member");
+	if (rmdir(QUA_CGROUP) != 0 && errno != ENOENT)
+		return;
+	if (cpuset_enabled_by_us) {
+		write_str(QUA_CGROUP_ROOT "/cgroup.subtree_control", "-cpuset");
+		cpuset_enabled_by_us = 0;
+	}
+}
+
+/*
+ * Per-CPU wakeup latency (PM QoS).
+ *
+ * cpuidle skips states whose exit latency exceeds the audio core's
+ * pm_qos_resume_latency_us, so the period interrupt is not delayed by a
+ * deep C-state exit. Only that core is affected, unlike /dev/cpu_dma_latency.
+ */
+static char wakeup_saved[32];
+static int wakeup_core = -1;
+
+int launcher_hold_wakeup_latency(int core_id, const char *value)
+{
+	char path[96];
+
+	if (wakeup_core >= 0 && wakeup_core != core_id)
+		launcher_release_wakeup_latency();
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/cpu/cpu%d/power/pm_qos_resume_latency_us", core_id);
+	/* Keep the value from before the first hold */
+	if (wakeup_core < 0 &&
+	    read_line(path, wakeup_saved, sizeof(wakeup_saved)) != 0)
+		return -1;
+	if (write_str(path, value) != 0)
+		return -1;
+	wakeup_core = core_id;
+	return 0;
+}
+
+void launcher_release_wakeup_latency(void)
+{
+	char path[96];
+
+	if (wakeup_core < 0)
+		return;
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/cpu/cpu%d/power/pm_qos_resume_latency_us", wakeup_core);
+	write_str(path, wakeup_saved);
+	wakeup_core = -1;
+}
+
+/*
+ * Controller IRQ co-location.
+ *
+ * The period interrupt is steered next to the player, so the wakeup does
+ * not cross cores (or CCXs) before the pinned poll() returns.
+ */
+static int steered_irqs[LAUNCHER_MAX_IRQS];
+static char steered_saved[LAUNCHER_MAX_IRQS][256];
+static int steered_count;
+
+int launcher_steer_irq(const char *device, int core_id, int use_sibling)
+{
+	char path[64], cpu[16];
+	cpu_set_t local;
+	int irqs[LAUNCHER_MAX_IRQS];
+
+	int card = device_card(device);
+	if (card < 0)
+		return -1;
+	int count = card_irqs(card, &local, irqs, LAUNCHER_MAX_IRQS);
+	if (count <= 0)
+		return -1;
+
+	int target = core_id;
+	if (use_sibling) {
+		cpu_set_t smt;
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", core_id);
+		if (read_cpulist(path, &smt) == 0) {
+			CPU_CLR(core_id, &smt);
+			if (CPU_COUNT(&smt))
+				target = first_cpu(&smt);
+		}
+	}
+	snprintf(cpu, sizeof(cpu), "%d", target);
+
+	/* Re-steering keeps the affinity saved by the first call */
+	int restore = steered_count == 0;
+	for (int i = 0; i < count; i++) {
+		snprintf(path, sizeof(path), "/proc/irq/%d/smp_affinity_list", irqs[i]);
+		if (restore) {
+			if (read_line(path, steered_saved[steered_count],
+				      sizeof(steered_saved[0])) != 0)
+				continue;
+			steered_irqs[steered_count++] = irqs[i];
+		}
+		write_str(path, cpu);
+	}
+	return steered_count ? target : -1;
+}
+
+void launcher_restore_irq(void)
+{
+	char path[64];
+
+	for (int i = 0; i < steered_count; i++) {
+		snprintf(path, sizeof(path), "/proc/irq/%d/smp_affinity_list", steered_irqs[i]);
+		write_str(path, steered_saved[i]);
+	}
+	steered_count = 0;
+}
+
+/*
+ * Where a standby loads: the audio core's L3, else its NUMA node, that we
+ * may run on, minus the audio core and its SMT siblings (they share its
+ * L1/L2). The player binds its arena to the node it runs on, so this also
+ * keeps the next track's memory on the audio core's node. Empty when
+ * nothing qualifies.
+ */
+static void standby_cpus(int core_id, cpu_set_t *set)
+{
+	char path[96];
+	cpu_set_t allowed, smt;
+
+	CPU_ZERO(set);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+		return;
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", core_id);
+	if (read_cpulist(path, &smt) != 0)
+		CPU_ZERO(&smt);
+	CPU_SET(core_id, &smt);
+
+	for (int pass = 0; pass < 2; pass++) {
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu%d/cache/index3/shared_cpu_list", core_id);
+		if ((pass ? node_cpus(core_id, set) : read_cpulist(path, set)) != 0)
+			continue;
+		CPU_AND(set, set, &allowed);
+		for (int c = 0; c < CPU_SETSIZE; c++)
+			if (CPU_ISSET(c, &smt))
+				CPU_CLR(c, set);
+		if (CPU_COUNT(set))
+			return;
+	}
+	CPU_ZERO(set);
+}
+
 _Noreturn void launcher_exec(int core_id, const char *player,
-			     char *const argv[])
+			     char *const argv[], int keep_fd, int standby)
 {
-	/* CPU affinity: pin to specified core */
+	/* CPU affinity: pin to specified core, a standby beside it (see above) */
 	cpu_set_t cpuset;
 	CPU_ZERO(&cpuset);
-	CPU_SET(core_id, &cpuset);
+	if (standby)
+		standby_cpus(core_id, &cpuset);
+	if (CPU_COUNT(&cpuset) == 0)
+		CPU_SET(core_id, &cpuset);
 	sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
 
-	/* Real-time priority: SCHED_FIFO at max */
-	struct sched_param param = { .sched_priority = 99 };
-	sched_setscheduler(0, SCHED_FIFO, &param);
+	/* Real-time priority: SCHED_FIFO at max, deferred for a standby */
+	struct sched_param param = { .sched_priority = standby ? 0 : 99 };
+	sched_setscheduler(0, standby ? SCHED_IDLE : SCHED_FIFO, &param);
 
 	/* OOM protection */
 	int oom_fd = open("/proc/self/oom_score_adj", O_WRONLY);
@@ -44,6 +523,15 @@ _Noreturn void launcher_exec(int core_id, const char *player,
 	//           PR_SPEC_DISABLE, 0, 0) == 0) {
 	// }
 
+	/* Hand-over fd becomes fd 3, without close-on-exec */
+	if (keep_fd >= 0) {
+		if (keep_fd != 3)
+			dup2(keep_fd, 3);
+		else
+			fcntl(3, F_SETFD, 0);
+	}
+	int kept = keep_fd >= 0 ? 3 : -1;
+
 	/* Close all file descriptors */
 	DIR *dir = opendir("/proc/self/fd");
 	if (dir) {
@@ -51,7 +539,7 @@ _Noreturn void launcher_exec(int core_id, const char *player,
 		int dir_fd = dirfd(dir);
 		while ((entry = readdir(dir)) != NULL) {
 			int fd = atoi(entry->d_name);
-			if (fd != dir_fd)
+			if (fd != dir_fd && fd != kept)
 				close(fd);
 		}
 		closedir(dir);
@@ -59,7 +547,8 @@ _Noreturn void launcher_exec(int core_id, const char *player,
 		struct rlimit rl;
 		if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
 			for (int fd = 0; fd < (int)rl.rlim_max; fd++)
-				close(fd);
+				if (fd != kept)
+					close(fd);
 		}
 	}
 
@@ -69,3 +558,16 @@ _Noreturn void launcher_exec(int core_id, const char *player,
 	execve(player, argv, NULL);
 	_exit(1);
 }
+
+int launcher_release(pid_t pid, int core_id, int gate_fd)
+{
+	struct sched_param param = { .sched_priority = 99 };
+	uint64_t go = 1;
+	cpu_set_t cpuset;
+
+	CPU_ZERO(&cpuset);
+	CPU_SET(core_id, &cpuset);
+	sched_setaffinity(pid, sizeof(cpu_set_t), &cpuset);
+	sched_setscheduler(pid, SCHED_FIFO, &param);
+	return write(gate_fd, &go, sizeof(go)) == sizeof(go) ? 0 : -1;
+}
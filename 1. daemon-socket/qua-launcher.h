@@ -1,15 +1,81 @@
 #ifndef QUA_LAUNCHER_H
 #define QUA_LAUNCHER_H
 
+#include <sys/types.h>
+
 /*
  * Prepare execution environment and exec the audio player.
  * Sets CPU affinity, real-time scheduling, OOM protection,
  * disables ASLR, closes all FDs, creates a new session,
  * then execve()s the player. Does not return on success.
+ * @keep_fd (-1 for none) survives as fd 3, e.g. the PCM memfd.
+ * A @standby player starts at SCHED_IDLE on @core_id's L3 (else NUMA node)
+ * without @core_id's physical core, so its load neither competes with the
+ * one playing nor evicts its L1/L2, and its arena lands on the same node;
+ * launcher_release() moves and raises it.
  *
  * Must be called in a forked child.
  */
 _Noreturn void launcher_exec(int core_id, const char *player,
-			     char *const argv[]);
+			     char *const argv[], int keep_fd, int standby);
+
+/*
+ * Let a standby player go: pinned to @core_id and SCHED_FIFO as
+ * launcher_exec() would have set, then a write to the eventfd @gate_fd it
+ * is parked on. Returns 0 or -1.
+ */
+int launcher_release(pid_t pid, int core_id, int gate_fd);
+
+/*
+ * Pick the audio core for an ALSA hw device ("hw:N,..." or "hw:NAME,..."):
+ * a primary SMT thread sharing L3 (CCX) and NUMA node with the CPU that
+ * handles the interrupt of the card's PCI function (e.g. the xHCI
+ * controller), other than that CPU's own core. @fallback_core is kept if it
+ * already qualifies and returned when the topology cannot be read.
+ */
+int launcher_pick_core(const char *device, int fallback_core);
+
+/*
+ * Make @core_id an isolated cgroup v2 cpuset partition (/sys/fs/cgroup/
+ * qua-audio), enabling the cpuset controller on the root if needed. With
+ * @decoder, one more CPU of its L3 (else NUMA node) joins it, for the
+ * player's FLAC decoder thread. Idempotent. Returns 0 on success, -1 (with
+ * everything undone) otherwise.
+ */
+int launcher_isolate(int core_id, int decoder);
+
+/*
+ * Move @pid (0: the calling process) into the partition; call before
+ * launcher_exec(), or for a standby before launcher_release()
+ */
+int launcher_isolate_join(pid_t pid);
+
+/*
+ * Turn the partition back into a member, remove it and disable the cpuset
+ * controller again if launcher_isolate() enabled it. Call once the player
+ * has exited.
+ */
+void launcher_isolate_release(void);
+
+/*
+ * Write @value to @core_id's pm_qos_resume_latency_us ("n/a": polling idle
+ * only, "N": C-states exiting within N us, "0": no constraint), remembering
+ * the previous value. Repeated holds keep the original value for release.
+ */
+int launcher_hold_wakeup_latency(int core_id, const char *value);
+
+/* Restore the value saved by the first hold, if any */
+void launcher_release_wakeup_latency(void);
+
+/*
+ * Steer the interrupts of @device's controller (see launcher_pick_core) to
+ * @core_id, or to its SMT sibling if @use_sibling and one exists. The
+ * previous smp_affinity_list of each IRQ is saved on the first call.
+ * Returns the target CPU or -1.
+ */
+int launcher_steer_irq(const char *device, int core_id, int use_sibling);
+
+/* Write back the affinities saved by launcher_steer_irq() */
+void launcher_restore_irq(void);
 
 #endif
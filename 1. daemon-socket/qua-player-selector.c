@@ -73,33 +73,73 @@ void init_player_paths(void) {
 	}
 }
 
+/*
+ * Walk the chunks up to "fmt ": RF64/BW64 put a ds64 chunk first and other
+ * writers may add JUNK/LIST/bext, so fmt is not always at offset 12.
+ */
 int parse_wav_header(const char *filepath, int *bits_per_sample, int *sample_rate, int *channels) {
 	int fd = open(filepath, O_RDONLY);
 	if (fd == -1) return -1;
 
-	uint8_t header[36];
-	ssize_t bytes_read = read(fd, header, 36);
-	if (bytes_read != 36) {
+	uint8_t header[12];
+	if (read(fd, header, 12) != 12) {
 		close(fd);
 		return -1;
 	}
 
-	if (strncmp((char *)header, "RIFF", 4) != 0 ||
-	    strncmp((char *)header + 8, "WAVE", 4) != 0 ||
-	    strncmp((char *)header + 12, "fmt ", 4) != 0) {
+	/* FLAC cache entry (CACHE_FLAC): STREAMINFO is always the first block */
+	if (strncmp((char *)header, "fLaC", 4) == 0) {
+		uint8_t si[18];
+		ssize_t n = pread(fd, si, sizeof(si), 8);
+		close(fd);
+		if (n != (ssize_t)sizeof(si))
+			return -1;
+		if (sample_rate)
+			*sample_rate = (si[10] << 12) | (si[11] << 4) | (si[12] >> 4);
+		if (channels)
+			*channels = ((si[12] >> 1) & 7) + 1;
+		if (bits_per_sample)
+			*bits_per_sample = (((si[12] & 1) << 4) | (si[13] >> 4)) + 1;
+		return 0;
+	}
+
+	if ((strncmp((char *)header, "RIFF", 4) != 0 &&
+	     strncmp((char *)header, "RF64", 4) != 0 &&
+	     strncmp((char *)header, "BW64", 4) != 0) ||
+	    strncmp((char *)header + 8, "WAVE", 4) != 0) {
 		close(fd);
 		return -1;
 	}
 
+	uint8_t chunk[8];
+	uint8_t fmt[16];
+	for (;;) {
+		uint32_t size;
+		if (read(fd, chunk, 8) != 8) {
+			close(fd);
+			return -1;
+		}
+		memcpy(&size, chunk + 4, 4);
+		if (strncmp((char *)chunk, "fmt ", 4) == 0)
+			break;
+		if (strncmp((char *)chunk, "data", 4) == 0 ||
+		    lseek(fd, (off_t)size + (size & 1), SEEK_CUR) == -1) {
+			close(fd);
+			return -1;
+		}
+	}
+	ssize_t bytes_read = read(fd, fmt, 16);
+	close(fd);
+	if (bytes_read != 16)
+		return -1;
+
 	uint16_t num_channels = 0;
 	uint32_t sample_rate_val = 0;
 	uint16_t bits_per_sample_val = 0;
 
-	memcpy(&num_channels, header + 22, 2);
-	memcpy(&sample_rate_val, header + 24, 4);
-	memcpy(&bits_per_sample_val, header + 34, 2);
-
-	close(fd);
+	memcpy(&num_channels, fmt + 2, 2);
+	memcpy(&sample_rate_val, fmt + 4, 4);
+	memcpy(&bits_per_sample_val, fmt + 14, 2);
 
 	if (bits_per_sample) *bits_per_sample = bits_per_sample_val;
 	if (sample_rate) *sample_rate = sample_rate_val;
@@ -6,6 +6,7 @@
 #define PGO_SUFFIX	".pgo9994x"
 
 void init_player_paths(void);
+// WAV/RF64, or a FLAC cache entry (STREAMINFO)
 int parse_wav_header(const char *filepath, int *bits_per_sample, int *sample_rate, int *channels);
 int select_player(const char *wav_file, char *player_out, size_t player_size);
 
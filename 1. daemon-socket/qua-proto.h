@@ -0,0 +1,27 @@
+#ifndef QUA_PROTO_H
+#define QUA_PROTO_H
+
+#include <stdint.h>
+
+// Protocol v2: one persistent connection, framed and pipelined. A client
+// opens with the magic, then sends frames; a connection that does not
+// start with it is a v1 text request (action\0data\0, one per connection).
+// Integers are in host byte order: the socket never leaves the machine.
+#define QUA_PROTO_MAGIC		"QUA2"
+#define QUA_PROTO_MAGIC_LEN	4
+#define QUA_FRAME_MAX		4096	/* Payload bytes per frame */
+
+enum {
+    QUA_REQUEST = 1,    // payload: action\0data\0, as in v1
+    QUA_REPLY = 2,      // payload: the v1 reply text; id of its request
+    QUA_EVENT = 3,      // payload: name\0arg\0, to subscribers; id 0
+};
+
+struct qua_frame {
+    uint32_t len;       // payload bytes that follow the header
+    uint32_t id;        // chosen by the client, echoed in the reply
+    uint16_t type;
+    uint16_t reserved;
+};
+
+#endif
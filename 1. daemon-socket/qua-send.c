@@ -16,6 +16,8 @@
 #include <fcntl.h>
 #include <poll.h>
 
+#include "qua-proto.h"
+
 #define SOCK_PATH "/tmp/qua-socket.sock"
 #define LOCK_PATH "/tmp/qua-socket-daemon.lock"
 #define CACHE_DIR "/dev/shm/qua-cache"
@@ -76,6 +78,58 @@ static int sock_exchange(const char *buf, size_t len,
 	return 0;
 }
 
+/*
+ * Protocol v2: one connection, subscribed to state changes, each event
+ * printed as "name arg" until the daemon goes away.
+ */
+static int cmd_watch(void)
+{
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return 1;
+
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	memcpy(addr.sun_path, SOCK_PATH, sizeof(SOCK_PATH));
+
+	static const char req[] = "subscribe";
+	struct {
+		char magic[QUA_PROTO_MAGIC_LEN];
+		struct qua_frame f;
+		char payload[sizeof(req)];
+	} __attribute__((packed)) hello = {
+		.f = { .len = sizeof(req), .id = 1, .type = QUA_REQUEST },
+	};
+	memcpy(hello.magic, QUA_PROTO_MAGIC, QUA_PROTO_MAGIC_LEN);
+	memcpy(hello.payload, req, sizeof(req));
+
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    write(fd, &hello, sizeof(hello)) != sizeof(hello)) {
+		close(fd);
+		return 1;
+	}
+
+	struct qua_frame f;
+	char payload[QUA_FRAME_MAX + 1];
+	for (;;) {
+		if (recv(fd, &f, sizeof(f), MSG_WAITALL) != sizeof(f) ||
+		    f.len > QUA_FRAME_MAX ||
+		    (f.len && recv(fd, payload, f.len, MSG_WAITALL) != (ssize_t)f.len))
+			break;
+		if (f.type != QUA_EVENT)
+			continue;
+		payload[f.len] = '\0';
+		const char *name = payload;
+		const char *arg = name + strlen(name) + 1;
+		if (arg < payload + f.len && *arg)
+			printf("%s %s\n", name, arg);
+		else
+			printf("%s\n", name);
+		fflush(stdout);
+	}
+	close(fd);
+	return 0;
+}
+
 /* ── Message building ────────────────────────────────────────── */
 
 /*
@@ -322,8 +376,11 @@ static void clear_cache(void)
 		closedir(d);
 	}
 
-	rm_rf_contents(CACHE_DIR);
-	puts("Cache cleared");
+	/* The daemon drops its index with the files; without one, clear here */
+	if (sock_exchange("cache-clear", 12, NULL, 0) < 0) {
+		rm_rf_contents(CACHE_DIR);
+		puts("Cache cleared");
+	}
 }
 
 /* ── History ─────────────────────────────────────────────────── */
@@ -603,6 +660,9 @@ static void show_help(void)
 "  stop            Stop playback\n"
 "  info            Show current track info\n"
 "  status          Show playback state (PLAYING/STOPPED)\n"
+"  stats           Show hook run/skip counts and wall times\n"
+"  watch           Print state changes as they happen (started, converted,\n"
+"                  stopped, position)\n"
 "  hist            Pick from history with fzf\n"
 "  hist-rofi       Pick from history with rofi\n"
 "  restart         Kill qua-socket, qua-player, qua-convert\n"
@@ -639,6 +699,10 @@ int main(int argc, char **argv)
 	/* status */
 	if (strcmp(action, "status") == 0)
 		return sock_exchange("status", 7, NULL, 0) < 0;
+	if (strcmp(action, "stats") == 0)
+		return sock_exchange("stats", 6, NULL, 0) < 0;
+	if (strcmp(action, "watch") == 0)
+		return cmd_watch();
 
 	/* play: try connect, auto-start daemon on failure, retry */
 	if (strcmp(action, "play") == 0) {
@@ -14,6 +14,7 @@ Actions:
   stop            Stop playback
   info            Show current track info
   status          Show playback state (PLAYING/STOPPED)
+  stats           Show hook run/skip counts and wall times
   hist            Pick from history with fzf
   hist-rofi       Pick from history with rofi
   restart         Kill qua-socket, qua-player, qua-convert
@@ -96,6 +97,9 @@ case "$ACTION" in
     status)
         printf '%s\0' "status" | socat - UNIX-CONNECT:/tmp/qua-socket.sock
         ;;
+    stats)
+        printf '%s\0' "stats" | socat - UNIX-CONNECT:/tmp/qua-socket.sock
+        ;;
     info)
         path=$(printf '%s\0' "$ACTION" | socat - UNIX-CONNECT:/tmp/qua-socket.sock)
         echo "$path"
@@ -126,8 +130,11 @@ case "$ACTION" in
         ;;
     cc)
         rm -f /dev/shm/raw-*
-        rm -rf /dev/shm/qua-cache/*
-        echo "Cache cleared"
+        # The daemon drops its index with the files; without one, clear here
+        if ! printf 'cache-clear\0' | socat - UNIX-CONNECT:/tmp/qua-socket.sock 2>/dev/null; then
+            rm -rf /dev/shm/qua-cache/*
+            echo "Cache cleared"
+        fi
         ;;
     *)
         {
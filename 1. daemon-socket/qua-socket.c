@@ -1,3 +1,4 @@
+#include <errno.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <spawn.h>
@@ -6,23 +7,30 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <time.h>
 #include <unistd.h>
 #include <limits.h>
 #include <dirent.h>
-#include <libgen.h>
 #include <sys/wait.h>
-#include <poll.h>
 #include <pthread.h>
+#include <sched.h>
 
 #include "qua-cache.h"
 #include "qua-config.h"
+#include "qua-dircache.h"
 #include "qua-launcher.h"
 #include "qua-player-selector.h"
+#include "qua-proto.h"
 
 extern char **environ;
 
@@ -44,46 +52,6 @@ static void log_ts(const char *fmt, ...) {
 #endif
 
 
-static void run_hook(const char *hook, const char *audio_path) {
-    if (access(hook, X_OK) != 0) return;
-
-    pid_t pid;
-    char *args[] = {(char *)hook, (char *)audio_path, NULL};
-    if (posix_spawn(&pid, hook, NULL, NULL, args, environ) == 0) {
-        waitpid(pid, NULL, 0);
-    }
-}
-
-struct hook_args {
-    char hook[PATH_MAX];
-    char audio_path[PATH_MAX];
-};
-
-static void *hook_worker(void *arg) {
-    struct hook_args *a = arg;
-    pid_t pid;
-    char *args[] = {a->hook, a->audio_path, NULL};
-    if (posix_spawn(&pid, a->hook, NULL, NULL, args, environ) == 0)
-        waitpid(pid, NULL, 0);
-    free(a);
-    return NULL;
-}
-
-static void run_hook_async(const char *hook, const char *audio_path) {
-    if (access(hook, X_OK) != 0) return;
-
-    struct hook_args *a = malloc(sizeof(*a));
-    if (!a) return;
-    snprintf(a->hook, sizeof(a->hook), "%s", hook);
-    snprintf(a->audio_path, sizeof(a->audio_path), "%s", audio_path);
-
-    pthread_t tid;
-    if (pthread_create(&tid, NULL, hook_worker, a) == 0) {
-        pthread_detach(tid);
-    } else {
-        free(a);
-    }
-}
 static FILE *history_fp;
 static char history_path[PATH_MAX];
 static char hook_prelaunch[PATH_MAX];
@@ -91,51 +59,6 @@ static char hook_teardown[PATH_MAX];
 static char last_played[PATH_MAX];
 static int state_is_playing;
 
-static int is_audio(const char *name) {
-    const char *dot = strrchr(name, '.');
-    if (!dot || dot == name || *(dot + 1) == '\0')
-        return 0;
-    dot++;
-    switch (dot[0]) {
-    case 'a': return strcmp(dot, "ape") == 0 || strcmp(dot, "aiff") == 0 || strcmp(dot, "aif") == 0;
-    case 'f': return strcmp(dot, "flac") == 0;
-    case 'm': return strcmp(dot, "mp3") == 0 || strcmp(dot, "m4a") == 0;
-    case 'o': return strcmp(dot, "opus") == 0 || strcmp(dot, "ogg") == 0;
-    case 'w': return strcmp(dot, "wv") == 0 || strcmp(dot, "wav") == 0;
-    default:  return 0;
-    }
-}
-
-static int filter_audio(const struct dirent *e) { return is_audio(e->d_name); }
-
-static int get_next(const char *current, int offset, char *result, size_t size) {
-    if (!current || !current[0]) return 1;
-
-    char *copy = strdup(current);
-    char *dir = dirname(copy);
-    struct dirent **list;
-
-    int n = scandir(dir, &list, filter_audio, alphasort);
-    if (n <= 0) { free(copy); return 1; }
-
-    int cur = -1;
-    for (int i = 0; i < n; i++) {
-        char full[PATH_MAX];
-        snprintf(full, sizeof(full), "%s/%s", dir, list[i]->d_name);
-        if (strcmp(full, current) == 0) { cur = i; break; }
-    }
-
-    int next = (cur == -1) ? 0 : (cur + offset) % n;
-    if (next < 0) next += n;
-
-    snprintf(result, size, "%s/%s", dir, list[next]->d_name);
-
-    for (int i = 0; i < n; i++) free(list[i]);
-    free(list);
-    free(copy);
-    return 0;
-}
-
 // TODO: Add logging for loaded paths and errors (missing XDG_CONFIG_HOME, etc.)
 static void init_paths(void) {
     const char *config = getenv("XDG_CONFIG_HOME");
@@ -191,39 +114,348 @@ static void log_play_history(const char *path) {
     fflush(history_fp);
 }
 
-// Check if any qua-player process is running
-static int player_is_running(void) {
-    DIR *proc = opendir("/proc");
-    if (!proc) return 0;
+// Everything runs on one epoll loop: requests are answered from memory and
+// the slow parts of a play (old player exiting, prelaunch hook, conversion)
+// are processes watched through pidfds, so their exits are just more events
+struct watch {
+    int fd;
+    void (*on_event)(struct watch *w);
+};
 
-    struct dirent *ent;
-    while ((ent = readdir(proc))) {
-        if (ent->d_name[0] < '0' || ent->d_name[0] > '9') continue;
+static int epoll_fd = -1;
 
-        char path[64];
-        snprintf(path, sizeof(path), "/proc/%s/comm", ent->d_name);
+static int watch_add(struct watch *w) {
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = w};
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, w->fd, &ev);
+}
 
-        FILE *f = fopen(path, "r");
-        if (!f) continue;
+static void watch_close(struct watch *w) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, w->fd, NULL);
+    close(w->fd);
+    w->fd = -1;
+}
 
-        char comm[32];
-        int found = fgets(comm, sizeof(comm), f) && strncmp(comm, "qua-player", 10) == 0;
-        fclose(f);
-        if (found) { closedir(proc); return 1; }
+static int pidfd_of(pid_t pid) {
+    return syscall(SYS_pidfd_open, pid, 0);
+}
+
+// A child of a job; pid drops to 0 once it has been reaped
+struct child {
+    struct watch w;
+    pid_t pid;
+    int status;
+};
+
+static void child_event(struct watch *w) {
+    struct child *c = (struct child *)w;
+    if (waitpid(c->pid, &c->status, WNOHANG) != c->pid)
+        return;
+    watch_close(w);
+    c->pid = 0;
+}
+
+static int child_spawn(struct child *c, const char *file, char *const argv[],
+                       const posix_spawn_file_actions_t *fa) {
+    c->status = -1;
+    if (posix_spawnp(&c->pid, file, fa, NULL, argv, environ) != 0) {
+        c->pid = 0;
+        return -1;
+    }
+    c->w.on_event = child_event;
+    c->w.fd = pidfd_of(c->pid);
+    if (c->w.fd == -1 || watch_add(&c->w) == -1) {
+        // No pidfd (kernel < 5.3): reap it in place, as before
+        if (c->w.fd != -1)
+            close(c->w.fd);
+        waitpid(c->pid, &c->status, 0);
+        c->pid = 0;
     }
-    closedir(proc);
     return 0;
 }
 
-// Native /proc-based player kill - no fork, direct syscalls
-static int kill_players_async(pid_t *pids, int max_pids) {
+static void child_kill(struct child *c) {
+    if (c->pid > 0)
+        kill(c->pid, SIGKILL);
+}
+
+static int child_ok(const struct child *c) {
+    return WIFEXITED(c->status) && WEXITSTATUS(c->status) == 0;
+}
+
+// SCHED_IDLE for background work: it only gets CPU nothing else wants.
+// Set from here, posix_spawnattr_setschedpolicy() refuses SCHED_IDLE.
+static void child_set_idle(struct child *c) {
+    struct sched_param sp = {0};
+    if (c->pid > 0)
+        sched_setscheduler(c->pid, SCHED_IDLE, &sp);
+}
+
+// Background work the user is now waiting for gets its share back
+static void child_set_normal(struct child *c) {
+    struct sched_param sp = {0};
+    if (c->pid > 0)
+        sched_setscheduler(c->pid, SCHED_OTHER, &sp);
+}
+
+// Who is owed an answer: a v1 client, whose fd is closed after it, or a
+// request on a v2 session, answered in a frame on a connection that stays
+struct reply_to {
+    int fd;
+    int session;
+    unsigned gen;                   // the session's, so a reused slot is not answered
+    uint32_t id;
+};
+
+#define REPLY_NONE ((struct reply_to){.fd = -1, .session = -1})
+
+// v2 sessions (qua-proto.h). A frame that cannot be written whole closes
+// the session: a subscriber that stops reading must not stall the daemon.
+#define SESSION_SLOTS 16
+
+static struct session {
+    struct watch w;
+    unsigned gen;
+    int subscribed;
+    size_t in_len;
+    char in[sizeof(struct qua_frame) + QUA_FRAME_MAX];
+} sessions[SESSION_SLOTS] = {[0 ... SESSION_SLOTS - 1] = {.w.fd = -1}};
+
+static struct watch position_timer = {.fd = -1};
+static struct timespec play_started;
+
+static void session_close(struct session *s) {
+    watch_close(&s->w);
+    s->gen++;
+    s->subscribed = 0;
+    s->in_len = 0;
+}
+
+static void session_send(int i, unsigned gen, int type, uint32_t id, const char *payload, size_t len) {
+    struct session *s = &sessions[i];
+    if (s->w.fd == -1 || s->gen != gen)
+        return;
+    if (len > QUA_FRAME_MAX)
+        len = QUA_FRAME_MAX;
+    struct qua_frame f = {.len = len, .id = id, .type = type};
+    struct iovec iov[2] = {{&f, sizeof(f)}, {(void *)payload, len}};
+    if (writev(s->w.fd, iov, 2) != (ssize_t)(sizeof(f) + len))
+        session_close(s);
+}
+
+// State changes pushed to subscribers: started, converted, stopped, position
+static void session_event_push(const char *name, const char *arg) {
+    char payload[QUA_FRAME_MAX];
+    int len = snprintf(payload, sizeof(payload), "%s%c%s", name, '\0', arg ? arg : "");
+    if (len < 0 || len >= (int)sizeof(payload))
+        return;
+    for (int i = 0; i < SESSION_SLOTS; i++)
+        if (sessions[i].subscribed)
+            session_send(i, sessions[i].gen, QUA_EVENT, 0, payload, len + 1);
+}
+
+static void reply_close(struct reply_to *r, const char *reply) {
+    if (r->session >= 0)
+        session_send(r->session, r->gen, QUA_REPLY, r->id, reply ? reply : "", reply ? strlen(reply) : 0);
+    else if (r->fd >= 0) {
+        if (reply)
+            write(r->fd, reply, strlen(reply));
+        close(r->fd);
+    }
+    *r = REPLY_NONE;
+}
+
+// Hooks change the system around playback (PipeWire, compositor), which is
+// the same before every track. So prelaunch runs on stopped -> playing
+// only, unless the script carries HOOK_PER_TRACK, and teardown on a real
+// stop only. Their wall time is kept for the stats verb.
+#define HOOK_PER_TRACK "# qua-hook: per-track"
+
+struct hook_stat {
+    int runs;
+    int skipped;
+    long long last_us, max_us, total_us;
+};
+
+struct hook_run {
+    struct child c;
+    struct timespec start;
+    struct hook_stat *stat;
+};
+
+static struct hook_stat stat_prelaunch, stat_teardown;
+static int env_prepared;
+
+static void hook_done(struct hook_run *h) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long us = (now.tv_sec - h->start.tv_sec) * 1000000LL + (now.tv_nsec - h->start.tv_nsec) / 1000;
+    h->stat->runs++;
+    h->stat->last_us = us;
+    h->stat->total_us += us;
+    if (us > h->stat->max_us)
+        h->stat->max_us = us;
+    log_ts("hook: done in %lld us", us);
+}
+
+static void hook_event(struct watch *w) {
+    child_event(w);
+    if (!((struct hook_run *)w)->c.pid)
+        hook_done((struct hook_run *)w);
+}
+
+static void hook_start(struct hook_run *h, struct hook_stat *stat, char *hook, const char *audio_path) {
+    char *args[] = {hook, (char *)audio_path, NULL};
+    h->stat = stat;
+    clock_gettime(CLOCK_MONOTONIC, &h->start);
+    if (child_spawn(&h->c, hook, args, NULL) != 0)
+        return;
+    if (h->c.pid)
+        h->c.w.on_event = hook_event;
+    else
+        hook_done(h);  // reaped in place (no pidfd)
+}
+
+static int hook_per_track(const char *hook) {
+    char head[4096];
+    int fd = open(hook, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return 0;
+    ssize_t n = read(fd, head, sizeof(head) - 1);
+    close(fd);
+    head[n > 0 ? n : 0] = '\0';
+    return strstr(head, HOOK_PER_TRACK) != NULL;
+}
+
+static struct hook_run teardown = {.c.w.fd = -1};
+
+static void stats_format(char *out, size_t size) {
+    const struct { const char *name; struct hook_stat *s; } hooks[] = {
+        {"prelaunch", &stat_prelaunch}, {"teardown", &stat_teardown}};
+    size_t used = 0;
+    for (int i = 0; i < 2 && used < size; i++) {
+        const struct hook_stat *s = hooks[i].s;
+        used += snprintf(out + used, size - used, "%s runs=%d skipped=%d last_ms=%.1f max_ms=%.1f mean_ms=%.1f\n",
+                         hooks[i].name, s->runs, s->skipped, s->last_us / 1000.0, s->max_us / 1000.0,
+                         s->runs ? s->total_us / 1000.0 / s->runs : 0.0);
+    }
+}
+
+// Players, tracked by pidfd from launch to exit. Ours are forked directly
+// and reaped from their pidfd event; one left over from a previous daemon
+// is adopted once at startup (child = 0) and only watched. A standby is
+// not playing yet: it neither holds up a launch nor dies with the player.
+#define PLAYER_SLOTS 4
+
+static struct player {
+    struct watch w;
+    pid_t pid;
+    int child;
+    int killed;
+    int standby;
+} players[PLAYER_SLOTS] = {[0 ... PLAYER_SLOTS - 1] = {.w.fd = -1}};
+
+// Warm standby: the next track's player, loaded and parked on an eventfd
+static struct {
+    struct player *p;
+    int gate;
+    char cache_path[PATH_MAX];      // kept after a failed try, so it is not retried
+} standby = {.gate = -1};
+
+static void standby_clear(void) {
+    if (standby.gate != -1)
+        close(standby.gate);
+    standby.gate = -1;
+    standby.p = NULL;
+}
+
+// What launch_player() set up around the player (partition, wakeup latency,
+// IRQ steering) is undone once playback has ended, by stop or a crash, and
+// the last player is gone: rmdir fails while the partition has a member
+static void playback_release(void) {
+    if (state_is_playing)
+        return;
+    for (int i = 0; i < PLAYER_SLOTS; i++)
+        if (players[i].w.fd != -1)
+            return;
+    if (LAUNCHER_ISOLATE)
+        launcher_isolate_release();
+    launcher_release_wakeup_latency();
+    launcher_restore_irq();
+}
+
+static void standby_drop(void);
+
+static void player_event(struct watch *w) {
+    struct player *p = (struct player *)w;
+    int status = 0;
+    if (p->child && waitpid(p->pid, &status, WNOHANG) != p->pid)
+        return;
+    watch_close(w);
+    log_ts("player: %d exited status=%d%s", p->pid, status, p->killed ? " (killed)" : "");
+    if (p == standby.p)
+        standby_clear();
+    // A clean exit is the end of the track, and the player itself asks for
+    // the next one; a crash leaves nothing playing, nor a standby to follow
+    if (!p->killed && p->child && !p->standby && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+        state_is_playing = 0;
+        session_event_push("stopped", NULL);
+        standby_drop();
+    }
+    p->pid = 0;
+    playback_release();
+}
+
+static struct player *player_track(pid_t pid, int child) {
+    for (int i = 0; i < PLAYER_SLOTS; i++) {
+        struct player *p = &players[i];
+        if (p->w.fd != -1)
+            continue;
+        p->w.fd = pidfd_of(pid);
+        p->w.on_event = player_event;
+        if (p->w.fd == -1 || watch_add(&p->w) == -1) {
+            if (p->w.fd != -1)
+                close(p->w.fd);
+            p->w.fd = -1;
+            return NULL;
+        }
+        p->pid = pid;
+        p->child = child;
+        p->killed = 0;
+        p->standby = 0;
+        return p;
+    }
+    return NULL;
+}
+
+static int players_alive(void) {
+    int n = 0;
+    for (int i = 0; i < PLAYER_SLOTS; i++)
+        n += players[i].w.fd != -1 && !players[i].standby;
+    return n;
+}
+
+// Signalled through the pidfd, so a recycled pid is never hit
+static int players_kill(void) {
+    int count = 0;
+    for (int i = 0; i < PLAYER_SLOTS; i++) {
+        struct player *p = &players[i];
+        if (p->w.fd == -1 || p->killed || p->standby)
+            continue;
+        syscall(SYS_pidfd_send_signal, p->w.fd, SIGKILL, NULL, 0);
+        p->killed = 1;
+        count++;
+    }
+    return count;
+}
+
+// The one /proc scan: a player that outlived a daemon restart
+static int players_adopt(void) {
     DIR *proc = opendir("/proc");
     if (!proc) return 0;
 
     struct dirent *ent;
     int count = 0;
-
-    while ((ent = readdir(proc)) && count < max_pids) {
+    while ((ent = readdir(proc))) {
         if (ent->d_name[0] < '0' || ent->d_name[0] > '9') continue;
 
         char path[64];
@@ -233,255 +465,809 @@ static int kill_players_async(pid_t *pids, int max_pids) {
         if (!f) continue;
 
         char comm[32];
-        if (fgets(comm, sizeof(comm), f) && strncmp(comm, "qua-player", 10) == 0) {
-            pid_t pid = atoi(ent->d_name);
-            kill(pid, SIGKILL);
-            pids[count++] = pid;
-        }
+        if (fgets(comm, sizeof(comm), f) && strncmp(comm, "qua-player", 10) == 0 &&
+            player_track(atoi(ent->d_name), 0))
+            count++;
         fclose(f);
     }
     closedir(proc);
     return count;
 }
 
-// Wait for all killed players to die
-static void kill_players_wait(pid_t *pids, int count) {
-    for (int i = 0; i < count; i++) {
-        waitpid(pids[i], NULL, 0);
-    }
+// Start qua-convert; with pcm_fd >= 0 it writes into that memfd (as its
+// fd 3) instead of output_path, and must leave it sealed
+static int convert_spawn(struct child *c, const char *input_path, const char *output_path, int pcm_fd) {
+    log_ts("convert_spawn: input=%s output=%s pcm_fd=%d", input_path, output_path, pcm_fd);
+
+    // With a memfd, output_path is the scratch file qua-convert works in
+    char *args[] = {QUA_CONVERT_CMD, (char *)input_path,
+                    pcm_fd >= 0 ? "/dev/fd/3" : (char *)output_path,
+                    pcm_fd >= 0 ? (char *)output_path : NULL, NULL};
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    if (pcm_fd >= 0)
+        posix_spawn_file_actions_adddup2(&fa, pcm_fd, 3);
+    int ret = child_spawn(c, QUA_CONVERT_CMD, args, &fa);
+    posix_spawn_file_actions_destroy(&fa);
+    if (ret != 0)
+        log_ts("convert_spawn: posix_spawnp failed");
+    return ret;
 }
 
-// Convenience: blocking kill (for stop command)
-static void kill_player(void) {
-    pid_t pids[16];
-    int count = kill_players_async(pids, 16);
-    kill_players_wait(pids, count);
-}
+// Check a finished qua-convert, returns 0 on success
+static int convert_check(const struct child *c, const char *output_path, int pcm_fd) {
+    log_ts("convert_check: status=0x%x", c->status);
 
-// Run qua-convert synchronously, returns 0 on success
-static int run_convert(const char *input_path, const char *output_path) {
-    log_ts("run_convert: input=%s output=%s", input_path, output_path);
-
-    pid_t pid;
-    char *args[] = {QUA_CONVERT_CMD, (char *)input_path, (char *)output_path, NULL};
-    int err = posix_spawnp(&pid, QUA_CONVERT_CMD, NULL, NULL, args, environ);
-
-    if (err != 0) {
-        log_ts("run_convert: posix_spawnp failed err=%d", err);
+    if (!child_ok(c)) {
+        log_ts("convert_check: bad exit, WIFEXITED=%d WEXITSTATUS=%d", WIFEXITED(c->status), WEXITSTATUS(c->status));
         return -1;
     }
 
-    int status;
-    waitpid(pid, &status, 0);
-    log_ts("run_convert: waitpid done, status=0x%x", status);
-
-    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
-        log_ts("run_convert: bad exit, WIFEXITED=%d WEXITSTATUS=%d", WIFEXITED(status), WEXITSTATUS(status));
-        return -1;
+    if (pcm_fd >= 0) {
+        // The player maps it read-only in place: it must be immutable now
+        int seals = fcntl(pcm_fd, F_GET_SEALS);
+        if (seals == -1 || !(seals & F_SEAL_WRITE)) {
+            log_ts("convert_check: memfd not sealed");
+            return -1;
+        }
+        log_ts("convert_check: success, memfd sealed");
+        return 0;
     }
 
     // Verify output file exists
     struct stat st;
     if (stat(output_path, &st) != 0 || !S_ISREG(st.st_mode)) {
-        log_ts("run_convert: output file not found");
+        log_ts("convert_check: output file not found");
         return -1;
     }
 
-    log_ts("run_convert: success, output size=%ld", (long)st.st_size);
+    log_ts("convert_check: success, output size=%ld", (long)st.st_size);
     return 0;
 }
 
-// Launch player binary with wav file (double-fork so init reaps it)
-static void launch_player(const char *player, const char *wav) {
-    log_ts("launch_player: input player=%s wav=%s", player, wav);
+// CACHE_FLAC: the entry is the converted WAV encoded losslessly, so the
+// FLAC_RESIDENT player decodes exactly what qua-convert produced.
+// Fastest preset: the entry lives in RAM, size matters more than ratio.
+static int flac_encode_spawn(struct child *c, const char *wav_path, const char *flac_path) {
+    char *args[] = {FLAC_ENCODE_CMD, "-0", "-s", "-f", "-o", (char *)flac_path, (char *)wav_path, NULL};
+    return child_spawn(c, FLAC_ENCODE_CMD, args, NULL);
+}
 
-    pid_t pid = fork();
-    if (pid == 0) {
-        // Intermediate child: fork again and exit
-        if (fork() == 0) {
-            // Grandchild: setup environment and exec player
-            char *args[] = {(char *)player, (char *)wav, "hw:0,0", NULL};
-            launcher_exec(LAUNCHER_CORE_ID, player, args);
-        }
-        _exit(0);  // Intermediate exits immediately
-    } else if (pid > 0) {
-        // Parent: reap intermediate child (instant)
-        waitpid(pid, NULL, 0);
-        log_ts("launch_player: launched via double-fork");
+// Conversion into a cache entry: qua-convert, directly or (CACHE_FLAC) via
+// a scratch WAV beside the entry that the encoder then turns into it.
+// The entry is written as <entry>.part and renamed into place when
+// complete, so a half-written file is never taken for a hit.
+enum { STAGE_IDLE, STAGE_PREPARE, STAGE_CONVERT, STAGE_ENCODE, STAGE_LAUNCH };
+
+struct conversion {
+    int stage;
+    int pcm_fd;
+    int background;                 // prefetch: children run SCHED_IDLE
+    char input_path[PATH_MAX];
+    char cache_path[PATH_MAX];
+    char part_path[PATH_MAX + 8];
+    char wav_path[PATH_MAX + 16];   // qua-convert's output, or its scratch file
+    struct child child;
+};
+
+// What a failed or killed qua-convert may leave behind: its output, or
+// with a memfd the scratch file and the .tmp its post-processing writes
+static void conversion_unlink(const struct conversion *cv) {
+    unlink(cv->wav_path);
+    if (cv->pcm_fd >= 0) {
+        char tmp[sizeof(cv->wav_path) + 4];
+        snprintf(tmp, sizeof(tmp), "%s.tmp", cv->wav_path);
+        unlink(tmp);
     }
 }
 
-static void prefetch_join(void);
+static int conversion_start(struct conversion *cv, const char *input_path, int pcm_fd) {
+    cv->pcm_fd = pcm_fd;
+    snprintf(cv->input_path, sizeof(cv->input_path), "%s", input_path);
+    snprintf(cv->part_path, sizeof(cv->part_path), "%s.part", cv->cache_path);
+    // The scratch name has extra dots, so a converter killed mid-write
+    // leaves nothing the startup sweep misses
+    if (pcm_fd >= 0)
+        snprintf(cv->wav_path, sizeof(cv->wav_path), "%s.scratch.wav", cv->cache_path);
+    else if (CACHE_FLAC)
+        snprintf(cv->wav_path, sizeof(cv->wav_path), "%s.wav", cv->cache_path);
+    else
+        snprintf(cv->wav_path, sizeof(cv->wav_path), "%s", cv->part_path);
+    if (convert_spawn(&cv->child, input_path, cv->wav_path, pcm_fd) != 0) {
+        conversion_unlink(cv);
+        return -1;
+    }
+    if (cv->background)
+        child_set_idle(&cv->child);
+    cv->stage = STAGE_CONVERT;
+    return 0;
+}
 
-static void spawn_play(const char *path) {
-    log_ts("spawn_play: START path=%s", path);
+static int conversion_commit(struct conversion *cv) {
+    session_event_push("converted", cv->input_path);
+    if (cv->pcm_fd >= 0)
+        return 0;  // the entry comes later, from cache_fill_async()
+    if (rename(cv->part_path, cv->cache_path) != 0) {
+        unlink(cv->part_path);
+        return -1;
+    }
+    cache_insert(cv->cache_path);
+    return 0;
+}
 
-    // Wait for any running prefetch (may have produced our cache file)
-    prefetch_join();
+// Advance after a child exit: 1 while running, 0 once the entry is complete,
+// -1 on failure or after child_kill (partial output removed)
+static int conversion_step(struct conversion *cv) {
+    while (cv->child.pid == 0) {
+        if (cv->stage == STAGE_CONVERT) {
+            if (convert_check(&cv->child, cv->wav_path, cv->pcm_fd) != 0) {
+                conversion_unlink(cv);
+                cv->stage = STAGE_IDLE;
+                return -1;
+            }
+            if (!CACHE_FLAC || cv->pcm_fd >= 0) {
+                cv->stage = STAGE_IDLE;
+                return conversion_commit(cv);
+            }
+            cv->stage = STAGE_ENCODE;
+            if (flac_encode_spawn(&cv->child, cv->wav_path, cv->part_path) != 0)
+                cv->child.status = -1;
+            else if (cv->background)
+                child_set_idle(&cv->child);
+        } else {
+            unlink(cv->wav_path);
+            cv->stage = STAGE_IDLE;
+            if (!child_ok(&cv->child)) {
+                log_ts("conversion: encoding %s failed", cv->cache_path);
+                unlink(cv->part_path);
+                return -1;
+            }
+            return conversion_commit(cv);
+        }
+    }
+    return 1;
+}
+
+// Cache miss with CONVERT_MEMFD: sealable memfd for the converter's output
+// (not with CACHE_FLAC: the memfd would hold PCM, the entry FLAC)
+static int pcm_memfd_create(void) {
+    if (!CONVERT_MEMFD || CACHE_FLAC)
+        return -1;
+    unsigned int flags = MFD_CLOEXEC | MFD_ALLOW_SEALING;
+    if (CONVERT_MEMFD == 2)
+        flags |= MFD_HUGETLB;
+    int fd = memfd_create("qua-pcm", flags);
+    if (fd == -1)
+        log_ts("pcm_memfd_create: failed, using the cache file");
+    return fd;
+}
 
-    // 1. Generate cache path
+// Copy a played memfd into the cache for the next time, then drop it.
+// A cross-filesystem link is not possible (memfds live on an internal
+// mount), so this is a plain copy behind the player, via .tmp + rename.
+// Each copy holds a fill slot until its worker posts the slot number back
+// through fill_done, so the entry counts as in flight meanwhile.
+#define FILL_SLOTS 4
+
+static char fill_path[FILL_SLOTS][PATH_MAX];    // "" = free
+static char playing_entry[PATH_MAX];            // pinned in the cache index
+static struct watch fill_done = {.fd = -1};
+static int fill_done_wr = -1;
+
+struct cache_fill_args {
+    int pcm_fd;
+    int slot;
     char cache_path[PATH_MAX];
-    if (cache_generate_path(path, cache_path, sizeof(cache_path)) != 0) {
-        log_ts("spawn_play: cache_generate_path failed");
-        return;
+};
+
+static void *cache_fill_worker(void *arg) {
+    struct cache_fill_args *a = arg;
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(a->pcm_fd, &st) == 0 && st.st_size > 0)
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, a->pcm_fd, 0);
+    if (map != MAP_FAILED) {
+        char tmp[PATH_MAX + 8];
+        snprintf(tmp, sizeof(tmp), "%s.tmp", a->cache_path);
+        int out = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        off_t done = 0;
+        while (out != -1 && done < st.st_size) {
+            ssize_t n = write(out, (char *)map + done, st.st_size - done);
+            if (n <= 0) break;
+            done += n;
+        }
+        if (out != -1) {
+            close(out);
+            if (done != st.st_size || rename(tmp, a->cache_path) != 0)
+                unlink(tmp);
+        }
+        munmap(map, st.st_size);
+        log_ts("cache_fill: %s %s", a->cache_path, done == st.st_size ? "done" : "failed");
     }
-    log_ts("spawn_play: cache_path=%s", cache_path);
-
-    // 2. Check if cached
-    int is_cached = cache_exists(cache_path);
-    log_ts("spawn_play: cache %s", is_cached ? "HIT" : "MISS");
-
-    // 3. Kill old players + prelaunch hook (always, regardless of cache)
-    log_ts("spawn_play: killing old players + prelaunch hook");
-    pid_t killed_pids[16];
-    int killed_count = kill_players_async(killed_pids, 16);
-    log_ts("spawn_play: killed %d players async", killed_count);
-    run_hook(hook_prelaunch, path);
-    log_ts("spawn_play: prelaunch hook done");
-    kill_players_wait(killed_pids, killed_count);
-    log_ts("spawn_play: players dead");
-
-    // 4. If cache miss, convert the file
-    if (!is_cached) {
-        cache_manage_size();
-        if (run_convert(path, cache_path) != 0) {
-            log_ts("spawn_play: run_convert failed, aborting");
+    close(a->pcm_fd);
+    write(fill_done_wr, &a->slot, sizeof(a->slot));
+    free(a);
+    return NULL;
+}
+
+static void fill_done_event(struct watch *w) {
+    int slot;
+    while (read(w->fd, &slot, sizeof(slot)) == sizeof(slot)) {
+        cache_insert(fill_path[slot]);
+        if (strcmp(fill_path[slot], playing_entry) == 0)
+            cache_pin(playing_entry, 1);
+        fill_path[slot][0] = '\0';
+    }
+}
+
+static void cache_fill_async(int pcm_fd, const char *cache_path) {
+    int slot = 0;
+    while (slot < FILL_SLOTS && fill_path[slot][0])
+        slot++;
+    struct cache_fill_args *a = NULL;
+    if (fill_done_wr != -1 && slot < FILL_SLOTS)
+        a = malloc(sizeof(*a));
+    pthread_t tid;
+    if (a) {
+        a->pcm_fd = pcm_fd;
+        a->slot = slot;
+        snprintf(a->cache_path, sizeof(a->cache_path), "%s", cache_path);
+        if (pthread_create(&tid, NULL, cache_fill_worker, a) == 0) {
+            pthread_detach(tid);
+            snprintf(fill_path[slot], sizeof(fill_path[slot]), "%s", cache_path);
             return;
         }
+        free(a);
     }
+    close(pcm_fd);
+}
 
-    // 5. Select player based on WAV specs
-    char player_path[PATH_MAX];
-    if (select_player(cache_path, player_path, sizeof(player_path)) != 0) {
-        log_ts("spawn_play: select_player failed, aborting");
-        return;
+// The converter's version and format policy (qua-convert --policy), read
+// once at startup and folded into every cache key. A converter without
+// --policy gives an empty one, which is still a consistent key.
+static void load_convert_policy(void) {
+    char policy[512] = "";
+    size_t len = 0;
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) == 0) {
+        pid_t pid;
+        char *args[] = {QUA_CONVERT_CMD, "--policy", NULL};
+        posix_spawn_file_actions_t fa;
+        posix_spawn_file_actions_init(&fa);
+        posix_spawn_file_actions_adddup2(&fa, fds[1], 1);
+        int err = posix_spawnp(&pid, QUA_CONVERT_CMD, &fa, NULL, args, environ);
+        posix_spawn_file_actions_destroy(&fa);
+        close(fds[1]);
+        if (err == 0) {
+            ssize_t n;
+            while (len < sizeof(policy) - 1 &&
+                   (n = read(fds[0], policy + len, sizeof(policy) - 1 - len)) > 0)
+                len += n;
+            policy[len] = '\0';
+            waitpid(pid, NULL, 0);
+        }
+        close(fds[0]);
     }
+    policy[strcspn(policy, "\n")] = '\0';
+    fprintf(stderr, "[qua-socket] Convert policy: %s\n", policy[0] ? policy : "(none)");
+    cache_set_policy(policy);
+}
 
-    // 6. Launch player
-    launch_player(player_path, cache_path);
-    log_ts("spawn_play: END");
+// Audio core, resolved once from the DAC's topology at startup
+static int audio_core = LAUNCHER_CORE_ID;
+
+// pcm_fd >= 0: the player gets the sealed memfd as fd 3 and wav names it.
+// gate >= 0: a standby, which gets that eventfd as fd 3 instead and waits
+// on it (see standby_fill) before opening the device.
+static struct player *launch_player(const char *player, const char *wav, int sample_rate,
+                                    int pcm_fd, int gate) {
+    log_ts("launch_player: input player=%s wav=%s pcm_fd=%d gate=%d", player, wav, pcm_fd, gate);
+
+    // Padding is passed in frames; the player plays it from a zeroed period
+    char head[24], tail[24];
+    snprintf(head, sizeof(head), "%lld", (long long)PADDING_HEAD_MS * sample_rate / 1000);
+    snprintf(tail, sizeof(tail), "%lld", (long long)PADDING_TAIL_MS * sample_rate / 1000);
+
+    // Kernel-enforced core isolation; playback goes ahead without it on failure
+    int isolated = LAUNCHER_ISOLATE && launcher_isolate(audio_core, CACHE_FLAC) == 0;
+    log_ts("launch_player: isolated=%d", isolated);
+    if (WAKEUP_LATENCY_US[0])
+        launcher_hold_wakeup_latency(audio_core, WAKEUP_LATENCY_US);
+    if (IRQ_STEER)
+        launcher_steer_irq(PLAYBACK_DEVICE, audio_core, IRQ_STEER == 2);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        // A standby joins on release; loading there would evict the live player
+        if (isolated && gate < 0)
+            launcher_isolate_join(0);
+        char *args[] = {(char *)player, (char *)wav, PLAYBACK_DEVICE, head, tail,
+                        gate >= 0 ? "3" : NULL, NULL};
+        launcher_exec(audio_core, player, args, gate >= 0 ? gate : pcm_fd, gate >= 0);
+    }
+    if (pid <= 0)
+        return NULL;
+    // Our own unreaped child, so its pid cannot have been recycled yet
+    struct player *p = player_track(pid, 1);
+    if (!p) {
+        log_ts("launch_player: cannot track %d, killing it", pid);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        return NULL;
+    }
+    p->standby = gate >= 0;
+    log_ts("launch_player: launched pid=%d", pid);
+    return p;
 }
 
-// Prefetch state
-static pthread_t prefetch_tid;
-static int prefetch_active;
+static void standby_drop(void) {
+    if (!standby.p)
+        return;
+    syscall(SYS_pidfd_send_signal, standby.p->w.fd, SIGKILL, NULL, 0);
+    standby.p->killed = 1;
+    standby_clear();
+    standby.cache_path[0] = '\0';
+}
 
-// Prefetch next track in background thread
+// Hand the device over to the standby if it holds this entry; any other
+// standby is of no use now
+static int standby_release(const char *cache_path) {
+    struct player *p = standby.p;
+    if (!p || strcmp(standby.cache_path, cache_path) != 0) {
+        standby_drop();
+        return -1;
+    }
+    if (LAUNCHER_ISOLATE && launcher_isolate(audio_core, CACHE_FLAC) == 0)
+        launcher_isolate_join(p->pid);
+    if (launcher_release(p->pid, audio_core, standby.gate) != 0) {
+        standby_drop();
+        return -1;
+    }
+    log_ts("standby: released pid=%d", p->pid);
+    p->standby = 0;
+    standby_clear();
+    standby.cache_path[0] = '\0';
+    return 0;
+}
 
-struct prefetch_args {
-    char current_path[PATH_MAX];
-};
+// Lookahead prefetch: the neighbours of the current track, most likely
+// first (+1, -1, +2, -2, ... within PREFETCH_AHEAD/PREFETCH_BEHIND), are
+// kept converted by a small pool of SCHED_IDLE conversions
+#define PREFETCH_SLOTS 8
+#define PREFETCH_PLAN (PREFETCH_AHEAD + PREFETCH_BEHIND)
+
+static struct conversion prefetch[PREFETCH_SLOTS];
+static int prefetch_jobs = 1;
+
+static int cache_inflight(const char *cache_path);
+
+static struct {
+    int count;
+    int next;                       // first target not yet started or skipped
+    char path[PREFETCH_PLAN][PATH_MAX];
+    char cache_path[PREFETCH_PLAN][PATH_MAX];
+} prefetch_plan;
+
+static void prefetch_init(void) {
+    long cpus = PREFETCH_JOBS ? PREFETCH_JOBS : sysconf(_SC_NPROCESSORS_ONLN) - 2;
+    prefetch_jobs = cpus < 1 ? 1 : cpus > PREFETCH_SLOTS ? PREFETCH_SLOTS : cpus;
+    for (int i = 0; i < PREFETCH_SLOTS; i++)
+        prefetch[i].background = 1;
+}
 
-static void *prefetch_worker(void *arg) {
-    struct prefetch_args *a = arg;
 
-    char next_path[PATH_MAX];
-    if (get_next(a->current_path, 1, next_path, sizeof(next_path)) != 0) {
-        free(a);
-        return NULL;
+static int prefetch_planned(const char *cache_path) {
+    for (int i = 0; i < prefetch_plan.count; i++)
+        if (strcmp(prefetch_plan.cache_path[i], cache_path) == 0)
+            return 1;
+    return 0;
+}
+
+// Re-plan around a new current track and kill conversions it left behind
+// (except keep_path's: the play attaches to that one)
+static void prefetch_replan(const char *current_path, const char *keep_path) {
+    prefetch_plan.count = 0;
+    prefetch_plan.next = 0;
+    for (int d = 1; d <= PREFETCH_AHEAD || d <= PREFETCH_BEHIND; d++) {
+        for (int dir = 1; dir >= -1; dir -= 2) {
+            if (d > (dir > 0 ? PREFETCH_AHEAD : PREFETCH_BEHIND))
+                continue;
+            char *path = prefetch_plan.path[prefetch_plan.count];
+            char *cache_path = prefetch_plan.cache_path[prefetch_plan.count];
+            if (dircache_next(current_path, d * dir, path, PATH_MAX) != 0 ||
+                strcmp(path, current_path) == 0 ||
+                cache_generate_path(path, cache_path, PATH_MAX) != 0 ||
+                prefetch_planned(cache_path))
+                continue;  // small directories wrap onto themselves
+            prefetch_plan.count++;
+        }
     }
 
-    char cache_path[PATH_MAX];
-    if (cache_generate_path(next_path, cache_path, sizeof(cache_path)) != 0) {
-        free(a);
-        return NULL;
+    for (int i = 0; i < PREFETCH_SLOTS; i++) {
+        if (prefetch[i].stage == STAGE_IDLE || prefetch_planned(prefetch[i].cache_path) ||
+            strcmp(prefetch[i].cache_path, keep_path) == 0)
+            continue;
+        log_ts("prefetch: cancelling %s", prefetch[i].cache_path);
+        child_kill(&prefetch[i].child);
     }
-    if (cache_exists(cache_path)) {
-        log_ts("prefetch: %s already cached", strrchr(next_path, '/') + 1);
-        free(a);
-        return NULL;
+}
+
+// Start planned conversions while slots are free. Stops short of the
+// eviction low-water mark, so lookahead never evicts anything itself.
+static void prefetch_fill(void) {
+    int running = 0;
+    struct conversion *slot = NULL;
+    for (int i = 0; i < PREFETCH_SLOTS; i++) {
+        if (prefetch[i].stage != STAGE_IDLE)
+            running++;
+        else if (!slot)
+            slot = &prefetch[i];
     }
 
-    log_ts("prefetch: starting background convert for %s",
-           strrchr(next_path, '/') + 1);
+    while (running < prefetch_jobs && prefetch_plan.next < prefetch_plan.count) {
+        int i = prefetch_plan.next++;
+        if (cache_exists(prefetch_plan.cache_path[i]) || cache_inflight(prefetch_plan.cache_path[i]))
+            continue;
+        if (cache_total_size() >= CACHE_LOW_WATER) {
+            log_ts("prefetch: no cache headroom");
+            prefetch_plan.next = prefetch_plan.count;
+            return;
+        }
 
-    pid_t pid;
-    char *args[] = {QUA_CONVERT_CMD, next_path, cache_path, NULL};
-    if (posix_spawnp(&pid, QUA_CONVERT_CMD, NULL, NULL, args, environ) == 0)
-        waitpid(pid, NULL, 0);
+        log_ts("prefetch: starting background convert for %s",
+               strrchr(prefetch_plan.path[i], '/') + 1);
+        snprintf(slot->cache_path, sizeof(slot->cache_path), "%s", prefetch_plan.cache_path[i]);
+        if (conversion_start(slot, prefetch_plan.path[i], -1) != 0)
+            continue;
+        running++;
+        while (slot < &prefetch[PREFETCH_SLOTS - 1] && slot->stage != STAGE_IDLE)
+            slot++;
+    }
+}
 
-    log_ts("prefetch: done %s", strrchr(next_path, '/') + 1);
-    free(a);
+static void prefetch_advance(void) {
+    for (int i = 0; i < PREFETCH_SLOTS; i++)
+        if (prefetch[i].stage != STAGE_IDLE && conversion_step(&prefetch[i]) != 1) {
+            log_ts("prefetch: done %s", prefetch[i].cache_path);
+            prefetch[i].background = 1;
+        }
+}
+
+static struct conversion *prefetch_find(const char *cache_path) {
+    for (int i = 0; i < PREFETCH_SLOTS; i++)
+        if (prefetch[i].stage != STAGE_IDLE && strcmp(prefetch[i].cache_path, cache_path) == 0)
+            return &prefetch[i];
     return NULL;
 }
 
-static void prefetch_join(void) {
-    if (prefetch_active) {
-        pthread_join(prefetch_tid, NULL);
-        prefetch_active = 0;
+// The play in flight. A newer request cancels it and waits in play_queued
+// until its children are gone, so two plays never race for the device.
+// STAGE_LAUNCH: the track is ready, the launch held while next/prev settles.
+static struct {
+    int stage;
+    int cancelled;
+    char path[PATH_MAX];
+    int hook_pending;               // prelaunch, once a teardown is over
+    struct hook_run hook;
+    struct conversion cv;
+    struct conversion *attached;    // the prefetch producing our entry
+    struct reply_to client;         // still owed a reply (!RESPOND_EARLY)
+    char reply[PATH_MAX + 32];
+} play_job = {.client = {.fd = -1, .session = -1}};
+
+static struct {
+    int pending;
+    char path[PATH_MAX];
+    struct reply_to client;
+    char reply[PATH_MAX + 32];
+} play_queued = {.client = {.fd = -1, .session = -1}};
+
+static int nav_settling;            // a burst of next/prev is still arriving
+
+// Single flight: every producer of a cache entry, looked up by its path.
+// A requester that finds one waits for it (play) or leaves it be (prefetch)
+// rather than decoding the same track a second time.
+static int cache_inflight(const char *cache_path) {
+    if (play_job.cv.stage != STAGE_IDLE && strcmp(play_job.cv.cache_path, cache_path) == 0)
+        return 1;
+    for (int i = 0; i < PREFETCH_SLOTS; i++)
+        if (prefetch[i].stage != STAGE_IDLE && strcmp(prefetch[i].cache_path, cache_path) == 0)
+            return 1;
+    for (int i = 0; i < FILL_SLOTS; i++)
+        if (strcmp(fill_path[i], cache_path) == 0)
+            return 1;
+    return 0;
+}
+
+static void play_job_start(void) {
+    log_ts("play_job: START path=%s", play_queued.path);
+    play_job.stage = STAGE_PREPARE;
+    play_job.cancelled = 0;
+    snprintf(play_job.path, sizeof(play_job.path), "%s", play_queued.path);
+    snprintf(play_job.reply, sizeof(play_job.reply), "%s", play_queued.reply);
+    play_job.client = play_queued.client;
+    play_job.cv.pcm_fd = -1;
+    play_queued.client = REPLY_NONE;
+    play_queued.pending = 0;
+
+    // A prefetch of this very track is attached to: the cache check waits
+    // for it. Ones the new lookahead no longer wants would only compete, so
+    // they go; the rest carry on at idle priority.
+    if (cache_generate_path(play_job.path, play_job.cv.cache_path, sizeof(play_job.cv.cache_path)) != 0)
+        play_job.cv.cache_path[0] = '\0';
+    prefetch_replan(play_job.path, play_job.cv.cache_path);
+    play_job.attached = play_job.cv.cache_path[0] ? prefetch_find(play_job.cv.cache_path) : NULL;
+    if (play_job.attached) {
+        log_ts("play_job: attached to prefetch of %s", play_job.cv.cache_path);
+        play_job.attached->background = 0;
+        child_set_normal(&play_job.attached->child);
     }
+
+    // Kill the old player; the launch waits for its pidfd, the hook does not
+    log_ts("play_job: killed %d players", players_kill());
+
+    // Track to track the environment stays prepared
+    play_job.hook_pending = 0;
+    if (access(hook_prelaunch, X_OK) != 0)
+        env_prepared = 1;
+    else if (!env_prepared || hook_per_track(hook_prelaunch))
+        play_job.hook_pending = 1;
+    else
+        stat_prelaunch.skipped++;
 }
 
-static void prefetch_next(const char *current_path) {
-    prefetch_join();
+// An attached prefetch goes back to idle priority; if the next play wants
+// the same entry it attaches again
+static void play_job_detach(void) {
+    struct conversion *cv = play_job.attached;
+    play_job.attached = NULL;
+    if (!cv || cv->stage == STAGE_IDLE)
+        return;
+    cv->background = 1;
+    child_set_idle(&cv->child);
+}
 
-    struct prefetch_args *a = malloc(sizeof(*a));
-    if (!a) return;
-    snprintf(a->current_path, sizeof(a->current_path), "%s", current_path);
+static void play_job_cancel(void) {
+    play_job.cancelled = 1;
+    child_kill(&play_job.cv.child);
+    play_job_detach();
+}
 
-    if (pthread_create(&prefetch_tid, NULL, prefetch_worker, a) == 0) {
-        prefetch_active = 1;
-    } else {
-        free(a);
+// -1 if the entry turned out to be gone from disk: dropped from the index,
+// so the caller converts it again
+static int play_job_launch(void) {
+    const char *cache_path = play_job.cv.cache_path;
+    int pcm_fd = play_job.cv.pcm_fd;
+    char wav_path[PATH_MAX];
+    if (pcm_fd >= 0)
+        snprintf(wav_path, sizeof(wav_path), "/proc/self/fd/%d", pcm_fd);
+    else
+        snprintf(wav_path, sizeof(wav_path), "%s", cache_path);
+
+    // Select player based on WAV specs
+    char player_path[PATH_MAX];
+    if (select_player(wav_path, player_path, sizeof(player_path)) != 0) {
+        if (pcm_fd < 0 && access(cache_path, F_OK) != 0) {
+            log_ts("play_job: %s vanished, converting again", cache_path);
+            cache_remove(cache_path);  // deleted behind the index's back
+            return -1;
+        }
+        log_ts("play_job: select_player failed, aborting");
+        return 0;
     }
+
+    // The entry being played is the last one eviction may take
+    cache_pin(playing_entry, 0);
+    snprintf(playing_entry, sizeof(playing_entry), "%s", cache_path);
+    cache_touch(cache_path);
+    cache_pin(cache_path, 1);
+
+    int sample_rate = 0;
+    parse_wav_header(wav_path, NULL, &sample_rate, NULL);
+    if (standby_release(cache_path) == 0 ||
+        launch_player(player_path, pcm_fd >= 0 ? "/dev/fd/3" : cache_path, sample_rate, pcm_fd, -1)) {
+        clock_gettime(CLOCK_MONOTONIC, &play_started);
+        session_event_push("started", play_job.path);
+    }
+
+    // The player holds its own reference; keep the PCM for next time
+    if (pcm_fd >= 0) {
+        cache_fill_async(pcm_fd, cache_path);
+        play_job.cv.pcm_fd = -1;
+    }
+    return 0;
 }
 
-// Coalesce rapid next/prev commands, returns net offset
-static int coalesce_navigation(int server_fd, int initial_offset,
-                               int first_client_fd, int *last_client_fd) {
-    int offset = initial_offset;
-    int coalesced_count = 0;
-    *last_client_fd = first_client_fd;
+static void play_job_finish(void) {
+    if (play_job.cv.pcm_fd >= 0) {
+        close(play_job.cv.pcm_fd);
+        play_job.cv.pcm_fd = -1;
+    }
+    play_job.stage = STAGE_IDLE;
+    if (play_job.cancelled) {
+        reply_close(&play_job.client, "Superseded\n");
+        log_ts("play_job: superseded %s", play_job.path);
+        return;
+    }
+    reply_close(&play_job.client, play_job.reply);
+    log_play_history(play_job.path);
+    log_ts("play_job: END");
+}
 
-    while (1) {
-        struct pollfd pfd = { .fd = server_fd, .events = POLLIN };
-        int ret = poll(&pfd, 1, COALESCE_TIMEOUT_MS);
-
-        if (ret <= 0) break;  // timeout or error
-
-        int new_fd = accept(server_fd, NULL, NULL);
-        if (new_fd == -1) break;
-
-        char buf[BUF_SIZE];
-        ssize_t n = read(new_fd, buf, sizeof(buf) - 1);
-        if (n <= 0) { close(new_fd); continue; }
-        buf[n] = '\0';
-
-        if (strcmp(buf, "play-next") == 0) {
-            offset++;
-            coalesced_count++;
-            dprintf(*last_client_fd, "Queued (+%d)\n", offset);
-            close(*last_client_fd);
-            *last_client_fd = new_fd;
-        } else if (strcmp(buf, "play-prev") == 0) {
-            offset--;
-            coalesced_count++;
-            dprintf(*last_client_fd, "Queued (%d)\n", offset);
-            close(*last_client_fd);
-            *last_client_fd = new_fd;
-        } else {
-            // Non-navigation command - drop during coalesce, user retries
-            close(new_fd);
-            break;
+static void play_job_advance(void) {
+    for (;;) {
+        if (play_job.stage == STAGE_IDLE) {
+            if (!play_queued.pending) return;
+            play_job_start();
+        }
+        // Never alongside a teardown still undoing the last session; a
+        // superseded job leaves it to the next one
+        if (play_job.cancelled)
+            play_job.hook_pending = 0;
+        if (play_job.hook_pending && !teardown.c.pid) {
+            play_job.hook_pending = 0;
+            env_prepared = 1;
+            hook_start(&play_job.hook, &stat_prelaunch, hook_prelaunch, play_job.path);
+        }
+        if (players_alive() || play_job.hook_pending || play_job.hook.c.pid)
+            return;
+
+        if (play_job.stage == STAGE_PREPARE) {
+            // Cancelled first: nothing still producing the entry may hold
+            // up the play queued behind us
+            if (play_job.cancelled || !play_job.cv.cache_path[0]) {
+                play_job_finish();
+                continue;
+            }
+            // Attached to whatever is already producing our entry
+            if (cache_inflight(play_job.cv.cache_path))
+                return;
+            play_job.attached = NULL;
+            if (cache_exists(play_job.cv.cache_path)) {
+                log_ts("play_job: cache HIT");
+                play_job.stage = STAGE_LAUNCH;
+            } else {
+                log_ts("play_job: cache MISS");
+                cache_manage_size();
+                if (conversion_start(&play_job.cv, play_job.path, pcm_memfd_create()) != 0) {
+                    play_job_finish();
+                    continue;
+                }
+                play_job.stage = STAGE_CONVERT;
+            }
+        }
+
+        int ret = play_job.stage == STAGE_LAUNCH ? 0 : conversion_step(&play_job.cv);
+        if (ret == 1)
+            return;
+        // Mid-burst the target may still move: everything up to the launch
+        // is done, the launch itself waits for the last next/prev
+        if (ret == 0 && !play_job.cancelled && nav_settling) {
+            play_job.stage = STAGE_LAUNCH;
+            return;
         }
+        if (ret == 0 && !play_job.cancelled && play_job_launch() != 0) {
+            play_job.stage = STAGE_PREPARE;
+            continue;
+        }
+        if (ret == 0 && play_job.cv.pcm_fd >= 0) {
+            // Superseded after the work was done: still worth caching
+            cache_fill_async(play_job.cv.pcm_fd, play_job.cv.cache_path);
+            play_job.cv.pcm_fd = -1;
+        }
+        play_job_finish();
+    }
+}
+
+// Once the current track plays and the next one is in the cache, the next
+// player is started early: loaded and locked at SCHED_IDLE, then parked on
+// an eventfd until play_job_launch() releases it in place of a launch
+static void standby_fill(void) {
+    if (!PLAYER_STANDBY || standby.p || !state_is_playing || !players_alive())
+        return;
+    char next[PATH_MAX], cache_path[PATH_MAX], player_path[PATH_MAX];
+    if (dircache_next(last_played, 1, next, sizeof(next)) != 0 ||
+        cache_generate_path(next, cache_path, sizeof(cache_path)) != 0 ||
+        strcmp(cache_path, standby.cache_path) == 0 ||
+        !cache_exists(cache_path) || cache_inflight(cache_path))
+        return;
+    snprintf(standby.cache_path, sizeof(standby.cache_path), "%s", cache_path);
+    if (select_player(cache_path, player_path, sizeof(player_path)) != 0)
+        return;
+    standby.gate = eventfd(0, EFD_CLOEXEC);
+    if (standby.gate == -1)
+        return;
+    int sample_rate = 0;
+    parse_wav_header(cache_path, NULL, &sample_rate, NULL);
+    standby.p = launch_player(player_path, cache_path, sample_rate, -1, standby.gate);
+    if (!standby.p)
+        standby_clear();
+}
+
+// Queue a play; it starts once the one in flight (if any) has unwound
+static void play_request(const char *path, struct reply_to client, const char *reply) {
+    state_is_playing = 1;
+    if (path != last_played)
+        snprintf(last_played, sizeof(last_played), "%s", path);
+    if (RESPOND_EARLY)
+        reply_close(&client, reply);
+
+    if (play_job.stage != STAGE_IDLE && !play_job.cancelled)
+        play_job_cancel();
+    reply_close(&play_queued.client, "Superseded\n");
+    play_queued.pending = 1;
+    snprintf(play_queued.path, sizeof(play_queued.path), "%s", path);
+    snprintf(play_queued.reply, sizeof(play_queued.reply), "%s", reply);
+    play_queued.client = client;
+}
+
+// Next/prev acts at once: the kill, the cache check and the conversion of
+// the target start on the first one. One arriving within COALESCE_TIMEOUT_MS
+// of the last redirects that work to the new target, and its launch waits
+// until the burst has settled, so a burst still ends in a single play.
+static struct {
+    struct watch w;                 // timerfd, armed while a burst is open
+    int open;
+    int offset;                     // net offset of the burst so far
+} nav = {.w.fd = -1};
+
+static void nav_event(struct watch *w) {
+    uint64_t expirations;
+    if (read(w->fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        return;
+    nav.open = 0;
+    nav.offset = 0;
+    if (nav_settling) {
+        log_ts("coalesce: settled");
+        nav_settling = 0;
     }
+}
 
-    if (coalesced_count > 0) {
-        log_ts("coalesce: merged %d commands, final offset=%+d", coalesced_count, offset);
+static void nav_request(int offset, struct reply_to client) {
+    // last_played is already the previous target, so the step is relative
+    char target[PATH_MAX];
+    if (dircache_next(last_played, offset, target, sizeof(target)) != 0) {
+        reply_close(&client, NULL);
+        return;
     }
 
-    return offset;
+    struct itimerspec its = {.it_value.tv_nsec = COALESCE_TIMEOUT_MS * 1000000L};
+    int in_burst = nav.open;
+    nav.offset = in_burst ? nav.offset + offset : offset;
+    nav.open = nav.w.fd != -1 && timerfd_settime(nav.w.fd, 0, &its, NULL) == 0;
+    if (in_burst) {
+        nav_settling = 1;
+        log_ts("coalesce: offset now %+d", nav.offset);
+    }
+
+    const char *basename = strrchr(target, '/');
+    basename = basename ? basename + 1 : target;
+    char reply[PATH_MAX + 32];
+    if (nav.offset == 1)
+        snprintf(reply, sizeof(reply), "Next: %s\n", basename);
+    else if (nav.offset == -1)
+        snprintf(reply, sizeof(reply), "Prev: %s\n", basename);
+    else
+        snprintf(reply, sizeof(reply), "Skipped %+d: %s\n", nav.offset, basename);
+    play_request(target, client, reply);
 }
 
-static void handle_command(int server_fd, int client_fd) {
-    char buf[BUF_SIZE];
-    ssize_t n = read(client_fd, buf, sizeof(buf) - 1);
-    if (n <= 0) return;
-    buf[n] = '\0';
+// An explicit play or stop ends any burst; its launch is not held
+static void nav_cancel(void) {
+    struct itimerspec its = {0};
+    if (nav.w.fd != -1)
+        timerfd_settime(nav.w.fd, 0, &its, NULL);
+    nav.open = 0;
+    nav.offset = 0;
+    nav_settling = 0;
+}
 
+// Answers client, now or, for play and next/prev, from the job it is handed to
+static void handle_command(struct reply_to client, char *buf) {
     // Parse null-terminated: action\0data\0
     char *action = buf;
     char *data = action + strlen(action) + 1;
+    char out[BUF_SIZE] = "";
 
     if (strcmp(action, "play") == 0) {
         const char *path = NULL;
@@ -496,79 +1282,179 @@ static void handle_command(int server_fd, int client_fd) {
         }
 
         if (path) {
-            state_is_playing = 1;
-            if (path != last_played)
-                snprintf(last_played, sizeof(last_played), "%s", path);
-            if (RESPOND_EARLY) {
-                dprintf(client_fd, "Playing: %s\n", strrchr(path, '/') ? strrchr(path, '/') + 1 : path);
-                shutdown(client_fd, SHUT_WR);
-            }
-            spawn_play(path);
-            if (!RESPOND_EARLY)
-                dprintf(client_fd, "Playing: %s\n", strrchr(path, '/') ? strrchr(path, '/') + 1 : path);
-            log_play_history(path);
-            prefetch_next(path);
-        } else {
-            dprintf(client_fd, "Nothing playable\n");
+            nav_cancel();
+            char reply[PATH_MAX + 32];
+            snprintf(reply, sizeof(reply), "Playing: %s\n", strrchr(path, '/') ? strrchr(path, '/') + 1 : path);
+            play_request(path, client, reply);
+            return;
         }
+        snprintf(out, sizeof(out), "Nothing playable\n");
     } else if (strcmp(action, "play-next") == 0 || strcmp(action, "play-prev") == 0) {
-        int initial_offset = (strcmp(action, "play-next") == 0) ? 1 : -1;
-        int last_fd;
-        int offset = coalesce_navigation(server_fd, initial_offset, client_fd, &last_fd);
-
-        char target[PATH_MAX];
-        if (get_next(last_played, offset, target, sizeof(target)) == 0) {
-            state_is_playing = 1;
-            snprintf(last_played, sizeof(last_played), "%s", target);
-            const char *basename = strrchr(target, '/');
-            basename = basename ? basename + 1 : target;
-            if (RESPOND_EARLY) {
-                if (offset == 1)
-                    dprintf(last_fd, "Next: %s\n", basename);
-                else if (offset == -1)
-                    dprintf(last_fd, "Prev: %s\n", basename);
-                else
-                    dprintf(last_fd, "Skipped %+d: %s\n", offset, basename);
-                shutdown(last_fd, SHUT_WR);
-            }
-            spawn_play(target);
-            if (!RESPOND_EARLY) {
-                if (offset == 1)
-                    dprintf(last_fd, "Next: %s\n", basename);
-                else if (offset == -1)
-                    dprintf(last_fd, "Prev: %s\n", basename);
-                else
-                    dprintf(last_fd, "Skipped %+d: %s\n", offset, basename);
-            }
-            log_play_history(target);
-            prefetch_next(target);
-        }
-        if (last_fd != client_fd) {
-            close(last_fd);
-        }
-        return;  // client_fd already handled or will be closed by caller
+        nav_request(strcmp(action, "play-next") == 0 ? 1 : -1, client);
+        return;
     } else if (strcmp(action, "stop") == 0) {
-        if (RESPOND_EARLY) {
-            dprintf(client_fd, "Stopped\n");
-            shutdown(client_fd, SHUT_WR);
-        }
-        kill_player();
+        nav_cancel();
+        reply_close(&play_queued.client, "Superseded\n");
+        play_queued.pending = 0;
+        if (play_job.stage != STAGE_IDLE)
+            play_job_cancel();
+        players_kill();
+        standby_drop();
+        cache_pin(playing_entry, 0);
+        if (state_is_playing)
+            session_event_push("stopped", NULL);
         state_is_playing = 0;
-        run_hook_async(hook_teardown, last_played);
-        if (!RESPOND_EARLY)
-            dprintf(client_fd, "Stopped\n");
+        playback_release();         // else when the killed players have exited
+        // Only a stop that ends a session puts the environment back
+        if (env_prepared && access(hook_teardown, X_OK) == 0 && !teardown.c.pid)
+            hook_start(&teardown, &stat_teardown, hook_teardown, last_played);
+        env_prepared = 0;
+        snprintf(out, sizeof(out), "Stopped\n");
     } else if (strcmp(action, "status") == 0) {
         if (state_is_playing && last_played[0])
-            dprintf(client_fd, "PLAYING %s\n", last_played);
+            snprintf(out, sizeof(out), "PLAYING %s\n", last_played);
         else
-            dprintf(client_fd, "STOPPED\n");
+            snprintf(out, sizeof(out), "STOPPED\n");
     } else if (strcmp(action, "info") == 0) {
-        if (last_played[0]) {
-            write(client_fd, last_played, strlen(last_played));
-        }
+        snprintf(out, sizeof(out), "%s", last_played);
     } else if (strcmp(action, "last") == 0) {
         if (last_played[0])
-            dprintf(client_fd, "%s\n", last_played);
+            snprintf(out, sizeof(out), "%s\n", last_played);
+    } else if (strcmp(action, "stats") == 0) {
+        stats_format(out, sizeof(out));
+    } else if (strcmp(action, "cache-clear") == 0) {
+        // Through here, so the index goes with the files
+        standby_drop();
+        cache_clear();
+        snprintf(out, sizeof(out), "Cache cleared\n");
+    } else if (strcmp(action, "subscribe") == 0) {
+        if (client.session >= 0) {
+            sessions[client.session].subscribed = 1;
+            // Position ticks run while anyone listens
+            struct itimerspec its = {.it_interval.tv_sec = 1, .it_value.tv_sec = 1};
+            if (position_timer.fd != -1)
+                timerfd_settime(position_timer.fd, 0, &its, NULL);
+            snprintf(out, sizeof(out), "Subscribed\n");
+        } else {
+            snprintf(out, sizeof(out), "subscribe needs protocol v2\n");
+        }
+    }
+    reply_close(&client, out);
+}
+
+static void position_event(struct watch *w) {
+    uint64_t expirations;
+    if (read(w->fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        return;
+    int listening = 0;
+    for (int i = 0; i < SESSION_SLOTS; i++)
+        listening |= sessions[i].subscribed;
+    if (!listening) {
+        struct itimerspec its = {0};
+        timerfd_settime(w->fd, 0, &its, NULL);
+        return;
+    }
+    if (!state_is_playing || play_job.stage != STAGE_IDLE || play_started.tv_sec == 0)
+        return;
+    // Since the player was started, head padding included
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    char ms[24];
+    snprintf(ms, sizeof(ms), "%lld", (now.tv_sec - play_started.tv_sec) * 1000LL +
+                                     (now.tv_nsec - play_started.tv_nsec) / 1000000);
+    session_event_push("position", ms);
+}
+
+// Complete request frames in order; a reply may come later (play), so
+// clients match replies to requests by id
+static void session_parse(struct session *s) {
+    const int i = s - sessions;
+    const unsigned gen = s->gen;
+    struct qua_frame f;
+    while (s->gen == gen && s->in_len >= sizeof(f)) {
+        memcpy(&f, s->in, sizeof(f));
+        if (f.type != QUA_REQUEST || f.len > QUA_FRAME_MAX) {
+            session_close(s);
+            return;
+        }
+        if (s->in_len < sizeof(f) + f.len)
+            return;
+        char buf[QUA_FRAME_MAX + 2];
+        memcpy(buf, s->in + sizeof(f), f.len);
+        buf[f.len] = buf[f.len + 1] = '\0';
+        s->in_len -= sizeof(f) + f.len;
+        memmove(s->in, s->in + sizeof(f) + f.len, s->in_len);
+        handle_command((struct reply_to){.fd = -1, .session = i, .gen = gen, .id = f.id}, buf);
+    }
+}
+
+static void session_event(struct watch *w) {
+    struct session *s = (struct session *)w;
+    ssize_t n = read(w->fd, s->in + s->in_len, sizeof(s->in) - s->in_len);
+    if (n == -1 && errno == EAGAIN) return;
+    if (n <= 0) {
+        session_close(s);
+        return;
+    }
+    s->in_len += n;
+    session_parse(s);
+}
+
+static void session_open(int fd, const char *rest, size_t len) {
+    for (int i = 0; i < SESSION_SLOTS; i++) {
+        struct session *s = &sessions[i];
+        if (s->w.fd != -1)
+            continue;
+        s->w.fd = fd;
+        s->w.on_event = session_event;
+        if (watch_add(&s->w) == -1)
+            break;
+        memcpy(s->in, rest, len);
+        s->in_len = len;
+        session_parse(s);
+        return;
+    }
+    close(fd);
+}
+
+// A v1 request is read whole, then answered and closed or handed to the
+// job that owes the answer. A v2 client is moved to a session.
+static void client_event(struct watch *w) {
+    char buf[BUF_SIZE];
+    ssize_t n = read(w->fd, buf, sizeof(buf) - 2);
+    if (n == -1 && errno == EAGAIN) return;
+
+    int client_fd = w->fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client_fd, NULL);
+    free(w);
+    if (n <= 0) {
+        close(client_fd);
+        return;
+    }
+    if (n >= QUA_PROTO_MAGIC_LEN && memcmp(buf, QUA_PROTO_MAGIC, QUA_PROTO_MAGIC_LEN) == 0) {
+        session_open(client_fd, buf + QUA_PROTO_MAGIC_LEN, n - QUA_PROTO_MAGIC_LEN);
+        return;
+    }
+    buf[n] = buf[n + 1] = '\0';
+    handle_command((struct reply_to){.fd = client_fd, .session = -1}, buf);
+}
+
+static void dir_watch_event(struct watch *w) {
+    (void)w;
+    dircache_handle_events();
+}
+
+static void server_event(struct watch *w) {
+    int client_fd;
+    while ((client_fd = accept4(w->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        struct watch *c = malloc(sizeof(*c));
+        if (c) {
+            c->fd = client_fd;
+            c->on_event = client_event;
+            if (watch_add(c) == 0) continue;
+            free(c);
+        }
+        close(client_fd);
     }
 }
 
@@ -576,8 +1462,10 @@ int main(void) {
     init_paths();
     init_player_paths();
     cache_init();
+    prefetch_init();
     find_playable_from_history(last_played, sizeof(last_played));
-    state_is_playing = player_is_running();
+    if (LAUNCHER_CORE_AUTO)
+        audio_core = launcher_pick_core(PLAYBACK_DEVICE, LAUNCHER_CORE_ID);
 
     // Single instance check
     int lock_fd = open(LOCK_PATH, O_CREAT | O_RDWR | O_CLOEXEC, 0666);
@@ -585,13 +1473,16 @@ int main(void) {
         fprintf(stderr, "[qua-socket] Already running or lock error.\n");
         return 1;
     }
+    cache_sweep_partial();
+    load_convert_policy();
 
     // Remove stale socket
     unlink(SOCKET_PATH);
 
     // Create socket
-    int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
-    if (server_fd == -1) {
+    struct watch server = {.on_event = server_event};
+    server.fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server.fd == -1) {
         perror("socket");
         return 1;
     }
@@ -599,29 +1490,78 @@ int main(void) {
     struct sockaddr_un addr = {.sun_family = AF_UNIX};
     strncpy(addr.sun_path, SOCKET_PATH, sizeof(addr.sun_path) - 1);
 
-    if (bind(server_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+    if (bind(server.fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
         perror("bind");
         return 1;
     }
 
-    if (listen(server_fd, 5) == -1) {
+    if (listen(server.fd, 16) == -1) {
         perror("listen");
         return 1;
     }
 
-    // No SIGCHLD handler needed. Synchronous children use specific-PID waitpid.
-    // Prefetch and async hooks run on worker threads that reap their own children.
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1 || watch_add(&server) == -1) {
+        perror("epoll");
+        return 1;
+    }
+    state_is_playing = players_adopt() > 0;
+    env_prepared = state_is_playing;
+
+    int fill_pipe[2];
+    if (pipe2(fill_pipe, O_NONBLOCK | O_CLOEXEC) == 0) {
+        fill_done.fd = fill_pipe[0];
+        fill_done.on_event = fill_done_event;
+        fill_done_wr = fill_pipe[1];
+        watch_add(&fill_done);
+    }
+
+    // Listings for next/prev and lookahead, invalidated by inotify
+    struct watch dir_watch = {.on_event = dir_watch_event};
+    dir_watch.fd = dircache_init();
+    if (dir_watch.fd != -1)
+        watch_add(&dir_watch);
+
+    // Without it subscribers get no position ticks
+    position_timer.on_event = position_event;
+    position_timer.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (position_timer.fd != -1 && watch_add(&position_timer) == -1) {
+        close(position_timer.fd);
+        position_timer.fd = -1;
+    }
+
+    // Without a timerfd navigation simply isn't coalesced
+    nav.w.on_event = nav_event;
+    nav.w.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (nav.w.fd != -1 && watch_add(&nav.w) == -1) {
+        close(nav.w.fd);
+        nav.w.fd = -1;
+    }
+
+    // No SIGCHLD handler needed. Job children and players are reaped from their pidfd events.
+    // Cache fills run on worker threads.
 
     // Ignore SIGPIPE (broken pipe when client disconnects)
     signal(SIGPIPE, SIG_IGN);
 
-    fprintf(stderr, "[qua-socket] Listening on %s\n", SOCKET_PATH);
+    fprintf(stderr, "[qua-socket] Listening on %s (audio core %d)\n", SOCKET_PATH, audio_core);
 
     while (1) {
-        int client_fd = accept(server_fd, NULL, NULL);
-        if (client_fd == -1) continue;
-        handle_command(server_fd, client_fd);
-        close(client_fd);
+        struct epoll_event events[16];
+        int n = epoll_wait(epoll_fd, events, 16, -1);
+        for (int i = 0; i < n; i++) {
+            struct watch *w = events[i].data.ptr;
+            w->on_event(w);
+        }
+        // Jobs only start or move on between batches, so no handler ever
+        // sees a watch that was closed and reused under it
+        prefetch_advance();
+        play_job_advance();
+        // Lookahead only once the play is out, never alongside its own work
+        if (play_job.stage == STAGE_IDLE) {
+            prefetch_fill();
+            standby_fill();
+        }
     }
 
     return 0;
@@ -3,12 +3,15 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <sched.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/file.h>
 #include <sys/prctl.h>
 #include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include <linux/prctl.h>
@@ -35,23 +38,142 @@
  * - Fixed Environment: Guarantees a consistent stack pointer address for
  * optimization determinism.
  *
+ * - Core Isolation (-i): Makes the core an isolated cgroup v2 cpuset
+ * partition for the player's lifetime. The launcher then stays in the
+ * foreground to restore the cgroup state once the player exits.
+ *
  * INPUT MAPPING:
+ * [-i]            -> Optional: isolate the core (needs root, cgroup v2)
  * $1 (argv[1]) -> Core ID (integer)
  * $2 (argv[2]) -> Binary Path (e.g., ./player.pgo3)
  * $3+ (argv[3..]) -> Arguments passed directly to the player
  */
 
+#define QUA_CGROUP_ROOT "/sys/fs/cgroup"
+#define QUA_CGROUP QUA_CGROUP_ROOT "/qua-audio"
+
+static int cpuset_enabled_by_us;
+static pid_t player_pid;
+
+static int write_str(const char *path, const char *s) {
+  int fd = open(path, O_WRONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  ssize_t len = (ssize_t)strlen(s);
+  int ret = write(fd, s, len) == len ? 0 : -1;
+  close(fd);
+  return ret;
+}
+
+static int read_str(const char *path, char *buf, size_t size) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  ssize_t n = read(fd, buf, size - 1);
+  close(fd);
+  if (n <= 0) {
+    return -1;
+  }
+  buf[n] = '\0';
+  buf[strcspn(buf, "\n")] = '\0';
+  return 0;
+}
+
+static void isolate_release(void) {
+  // Hands the CPU back to the root even if the group cannot be removed
+  write_str(QUA_CGROUP "/cpuset.cpus.partition", "member");
+  if (rmdir(QUA_CGROUP) == 0 && cpuset_enabled_by_us) {
+    write_str(QUA_CGROUP_ROOT "/cgroup.subtree_control", "-cpuset");
+  }
+}
+
+// Same layout as the socket daemon's launcher_isolate()
+static int isolate_core(int core) {
+  char buf[256];
+  if (read_str(QUA_CGROUP_ROOT "/cgroup.subtree_control", buf, sizeof(buf)) != 0) {
+    buf[0] = '\0';
+  }
+  if (!strstr(buf, "cpuset")) {
+    if (write_str(QUA_CGROUP_ROOT "/cgroup.subtree_control", "+cpuset") != 0) {
+      return -1;
+    }
+    cpuset_enabled_by_us = 1;
+  }
+  if (mkdir(QUA_CGROUP, 0755) != 0 && errno != EEXIST) {
+    isolate_release();
+    return -1;
+  }
+  snprintf(buf, sizeof(buf), "%d", core);
+  write_str(QUA_CGROUP "/cpuset.cpus.exclusive", buf); // 6.7+, optional
+  if (write_str(QUA_CGROUP "/cpuset.cpus", buf) != 0 ||
+      write_str(QUA_CGROUP "/cpuset.cpus.partition", "isolated") != 0 ||
+      read_str(QUA_CGROUP "/cpuset.cpus.partition", buf, sizeof(buf)) != 0 ||
+      strcmp(buf, "isolated") != 0) {
+    isolate_release();
+    return -1;
+  }
+  return 0;
+}
+
+// Ctrl-C/kill reaches the launcher, not the setsid()'d player: pass it on
+static void forward_signal(int sig) {
+  if (player_pid > 0) {
+    kill(player_pid, sig);
+  }
+}
+
 int main(int argc, char *argv[]) {
   printf("--- [LAUNCHER DEBUG] Starting Setup ---\n");
 
+  int isolate = 0;
+  if (argc > 1 && strcmp(argv[1], "-i") == 0) {
+    isolate = 1;
+    argv++;
+    argc--;
+  }
+
   if (argc < 3) {
     fprintf(stderr, "[ERROR] Missing arguments.\n");
-    fprintf(stderr, "Usage: bare-launcher <core_id> <player_path> [args...]\n");
+    fprintf(stderr, "Usage: bare-launcher [-i] <core_id> <player_path> [args...]\n");
     return 1;
   }
 
   // --- INPUT 1: CORE ID ---
   int target_core = atoi(argv[1]);
+
+  // --- CORE ISOLATION (cgroup v2 cpuset partition) ---
+  if (isolate) {
+    if (isolate_core(target_core) == 0) {
+      printf("[SUCCESS] Core %d isolated (%s)\n", target_core, QUA_CGROUP);
+    } else {
+      fprintf(stderr, "[FAILED] Isolation: %s (Check root and cgroup v2!)\n",
+              strerror(errno));
+      isolate = 0;
+    }
+  }
+  if (isolate) {
+    fflush(stdout);
+    player_pid = fork();
+    if (player_pid > 0) {
+      // Parent: wait for the player, then restore
+      signal(SIGINT, forward_signal);
+      signal(SIGTERM, forward_signal);
+      int status = 0;
+      while (waitpid(player_pid, &status, 0) == -1 && errno == EINTR) {
+      }
+      isolate_release();
+      printf("[SUCCESS] Isolation released\n");
+      return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+    }
+    if (player_pid < 0) {
+      fprintf(stderr, "[FAILED] fork: %s\n", strerror(errno));
+      isolate_release();
+      return 1;
+    }
+    write_str(QUA_CGROUP "/cgroup.procs", "0");
+  }
   cpu_set_t cpuset;
   CPU_ZERO(&cpuset);
   CPU_SET(target_core, &cpuset);
@@ -1,6 +1,14 @@
 // qua-convert: Single responsibility - decode audio file to WAV
 // Usage: qua-convert <input-file> [output-wav-path]
+//        qua-convert <input-file> /dev/fd/N [scratch-wav-path]
+//        qua-convert --policy
 // If no output path given, writes <basename>.wav in CWD.
+// If the output path is /dev/fd/N and N is a sealable memfd, the final WAV
+// goes into the memfd (data page-aligned, sealed) and no file is left behind.
+// The scratch path lets the caller pick where the intermediate WAV (and its
+// .tmp) live, so it can clean up after a converter it had to kill.
+// --policy prints the version and target format policy on one line; the
+// daemon keys its cache on it, so entries from another policy never hit.
 // Exit codes: 0 = success, 1 = error
 
 #include <libgen.h>
@@ -9,6 +17,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <fcntl.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -17,13 +26,24 @@
 #include "qua-config.h"
 #include "qua-post-processing.h"
 
+// Bump whenever the same input would now convert to different output
+#define QUA_CONVERT_VERSION 1
+
+static int convert_to_output(const char *input_file, const char *output_file, int out_fd);
 
 int main(int argc, char *argv[]) {
   if (argc < 2) {
-    fprintf(stderr, "Usage: %s <input-audio-file> [output-wav-path]\n", argv[0]);
+    fprintf(stderr, "Usage: %s <input-audio-file> [output-wav-path] | --policy\n", argv[0]);
     return 1;
   }
 
+  if (strcmp(argv[1], "--policy") == 0) {
+    printf("qua-convert %d bd=%s/%s/%d sr=%s/%s/%d\n", QUA_CONVERT_VERSION,
+           BIT_DEPTH_VALID, BIT_DEPTH_OVERRIDE, BIT_DEPTH_FALLBACK,
+           SAMPLE_RATE_VALID, SAMPLE_RATE_OVERRIDE, SAMPLE_RATE_FALLBACK);
+    return 0;
+  }
+
   char input_file[PATH_MAX] = {0};
   char default_output[PATH_MAX] = {0};
   const char *output_file;
@@ -48,6 +68,29 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
+  // memfd handoff: decode and post-process in a scratch file, the last step
+  // writes into the memfd. The caller may name the scratch file.
+  int out_fd = -1;
+  char scratch[PATH_MAX];
+  if (strncmp(output_file, "/dev/fd/", 8) == 0) {
+    int fd = atoi(output_file + 8);
+    if (fcntl(fd, F_GET_SEALS) >= 0) {
+      out_fd = fd;
+      if (argc >= 4)
+        snprintf(scratch, sizeof(scratch), "%s", argv[3]);
+      else
+        snprintf(scratch, sizeof(scratch), "/dev/shm/qua-convert-%d.wav", getpid());
+      output_file = scratch;
+    }
+  }
+
+  int ret = convert_to_output(input_file, output_file, out_fd);
+  if (out_fd >= 0)
+    unlink(output_file);
+  return ret;
+}
+
+static int convert_to_output(const char *input_file, const char *output_file, int out_fd) {
   // Decode audio to output file
   wav_info_t detected;
   decode_params_t decode_params = {
@@ -77,6 +120,7 @@ int main(int argc, char *argv[]) {
   bool needs_post_process = (detected.is_float || detected.channels != 2 ||
                              target_bd != detected.bit_depth || target_sr != detected.sample_rate);
 
+  bool in_memfd = false;
   if (needs_post_process) {
     // Float conversion must go through sox (no fast path for float)
     if (detected.is_float) {
@@ -89,17 +133,19 @@ int main(int argc, char *argv[]) {
     // FAST PATH: Only bit depth 24->32 conversion is needed
     else if (detected.bit_depth == 24 && target_bd == 32 && detected.channels == 2 && detected.sample_rate == target_sr) {
       fprintf(stderr, "Applying fast 24-bit to 32-bit conversion...\n");
-      if (convert_24bit_to_32bit_wav_ultrafast(output_file) != 0) {
+      if (convert_24bit_to_32bit_wav_ultrafast(output_file, out_fd) != 0) {
         fprintf(stderr, "Error: Fast bit-depth conversion failed\n");
         return 1;
       }
+      in_memfd = out_fd >= 0;
     }
     else if (detected.bit_depth == 16 && target_bd == 32 && detected.channels == 2 && detected.sample_rate == target_sr) {
       fprintf(stderr, "Applying fast 16-bit to 32-bit conversion...\n");
-      if (convert_16bit_to_32bit_wav_fast(output_file) != 0) {
+      if (convert_16bit_to_32bit_wav_fast(output_file, out_fd) != 0) {
         fprintf(stderr, "Error: Fast 16-bit conversion failed\n");
         return 1;
       }
+      in_memfd = out_fd >= 0;
     }
     // SLOW PATH: Channel mixing, resampling, or complex bit depth changes
     else {
@@ -111,5 +157,10 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  if (out_fd >= 0 && !in_memfd && wav_to_memfd(output_file, out_fd) != 0) {
+    fprintf(stderr, "Error: Could not write to memfd\n");
+    return 1;
+  }
+
   return 0;
 }
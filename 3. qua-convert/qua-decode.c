@@ -15,6 +15,7 @@
 
 
 // Parse WAV header directly without using soxi
+// Walks the chunks, so RF64/BW64 (ds64 first) and JUNK/LIST before fmt work
 int parse_wav_header(const char *filepath, wav_info_t *info) {
   if (!info)
     return -1;
@@ -23,43 +24,92 @@ int parse_wav_header(const char *filepath, wav_info_t *info) {
   if (fd == -1)
     return -1;
 
-  uint8_t header[36]; // RIFF header (12) + fmt chunk header (8) + fmt data (16) = 36
+  uint8_t header[12]; // RIFF/RF64/BW64 + size + WAVE
 
-  if (read(fd, header, 36) != 36) {
-    close(fd);
-    return -1;
-  }
-
-  // Check RIFF/WAVE header and fmt chunk
-  if (strncmp((char *)header, "RIFF", 4) != 0 ||
-      strncmp((char *)header + 8, "WAVE", 4) != 0 ||
-      strncmp((char *)header + 12, "fmt ", 4) != 0) {
+  if (read(fd, header, 12) != 12 ||
+      (strncmp((char *)header, "RIFF", 4) != 0 &&
+       strncmp((char *)header, "RF64", 4) != 0 &&
+       strncmp((char *)header, "BW64", 4) != 0) ||
+      strncmp((char *)header + 8, "WAVE", 4) != 0) {
     close(fd);
     return -1;
   }
 
   // Extract values (assumes little-endian system)
-  // fmt data starts at offset 20 (12 RIFF + 8 fmt header)
   uint16_t audio_format = 0;
   uint16_t num_channels = 0;
   uint32_t sample_rate_val = 0;
   uint16_t bits_per_sample_val = 0;
+  uint64_t ds64_data_bytes = 0;
+  uint64_t data_bytes = 0;
+  bool fmt_found = false, data_found = false;
 
-  memcpy(&audio_format, header + 20, 2);        // offset 20: audio format (1=PCM, 3=IEEE float)
-  memcpy(&num_channels, header + 22, 2);        // offset 22: channels
-  memcpy(&sample_rate_val, header + 24, 4);     // offset 24: sample_rate
-  memcpy(&bits_per_sample_val, header + 34, 2); // offset 34: bits_per_sample
+  uint8_t chunk[8];
+  while (!data_found && read(fd, chunk, 8) == 8) {
+    uint32_t size;
+    memcpy(&size, chunk + 4, 4);
+    off_t next = lseek(fd, 0, SEEK_CUR) + size + (size & 1);
+
+    if (memcmp(chunk, "ds64", 4) == 0 && size >= 16) {
+      uint8_t ds64[16]; // riffSize, dataSize (64-bit each)
+      if (read(fd, ds64, 16) != 16)
+        break;
+      memcpy(&ds64_data_bytes, ds64 + 8, 8);
+    } else if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+      uint8_t fmt[16];
+      if (read(fd, fmt, 16) != 16)
+        break;
+      memcpy(&audio_format, fmt, 2);         // audio format (1=PCM, 3=IEEE float)
+      memcpy(&num_channels, fmt + 2, 2);     // channels
+      memcpy(&sample_rate_val, fmt + 4, 4);  // sample_rate
+      memcpy(&bits_per_sample_val, fmt + 14, 2); // bits_per_sample
+      fmt_found = true;
+    } else if (memcmp(chunk, "data", 4) == 0) {
+      data_bytes = (size == 0xFFFFFFFF) ? ds64_data_bytes : size;
+      data_found = true;
+    }
+    lseek(fd, next, SEEK_SET);
+  }
 
   close(fd);
 
+  if (!fmt_found)
+    return -1;
+
   info->bit_depth = bits_per_sample_val;
   info->sample_rate = sample_rate_val;
   info->channels = num_channels;
   info->is_float = (audio_format == 3);
+  info->data_bytes = data_bytes;
+  info->frames = (num_channels && bits_per_sample_val >= 8)
+                     ? data_bytes / ((uint64_t)num_channels * (bits_per_sample_val / 8))
+                     : 0;
 
   return 0;
 }
 
+// flac -d writes classic WAVE and fails past 4GB; STREAMINFO (always the
+// first metadata block) tells up front whether RF64 is needed
+static bool flac_needs_rf64(const char *path) {
+  uint8_t si[26]; // "fLaC" + block header + STREAMINFO up to total samples
+  int fd = open(path, O_RDONLY);
+  if (fd == -1)
+    return false;
+  ssize_t n = read(fd, si, sizeof(si));
+  close(fd);
+  if (n != sizeof(si) || memcmp(si, "fLaC", 4) != 0)
+    return false;
+
+  // 20 bits rate, 3 bits channels-1, 5 bits bps-1, 36 bits total samples
+  uint64_t packed = 0;
+  for (int i = 18; i < 26; i++)
+    packed = (packed << 8) | si[i];
+  uint64_t channels = ((packed >> 41) & 0x7) + 1;
+  uint64_t bytes_per_sample = ((((packed >> 36) & 0x1F) + 1) + 7) / 8;
+  uint64_t frames = packed & 0xFFFFFFFFFULL;
+  return frames * channels * bytes_per_sample > 0xFFFFFFFFULL - 4096;
+}
+
 void *convert_audio(void *arg) {
   decode_params_t *params = (decode_params_t *)arg;
 
@@ -87,8 +137,12 @@ void *convert_audio(void *arg) {
   switch (ext[0]) {
   case 'f': // .flac
     if (strcmp(ext, "flac") == 0) {
+      bool rf64 = flac_needs_rf64(params->input_path);
       if ((pid = vfork()) == 0) {
-        execlp("flac", "flac", "-d", "-s", "--decode-through-errors", "-f", params->input_path, "-o", output_file, NULL);
+        if (rf64)
+          execlp("flac", "flac", "-d", "-s", "--decode-through-errors", "-f", "--force-rf64-format", params->input_path, "-o", output_file, NULL);
+        else
+          execlp("flac", "flac", "-d", "-s", "--decode-through-errors", "-f", params->input_path, "-o", output_file, NULL);
         _exit(1);
       }
       break;
@@ -106,7 +160,7 @@ void *convert_audio(void *arg) {
     if (strcmp(ext, "wav") == 0) {
       if ((pid = vfork()) == 0) {
         execlp("ffmpeg", "ffmpeg", "-v", "quiet", "-y", "-i", params->input_path,
-               "-f", "wav", output_file, NULL);
+               "-f", "wav", "-rf64", "auto", output_file, NULL);
         _exit(1);
       }
       break;
@@ -124,7 +178,7 @@ void *convert_audio(void *arg) {
     if (strcmp(ext, "aiff") == 0 || strcmp(ext, "aif") == 0) {
       if ((pid = vfork()) == 0) {
         execlp("ffmpeg", "ffmpeg", "-v", "quiet", "-y", "-i", params->input_path,
-               "-f", "wav", output_file, NULL);
+               "-f", "wav", "-rf64", "auto", output_file, NULL);
         _exit(1);
       }
       break;
@@ -142,7 +196,7 @@ void *convert_audio(void *arg) {
     if (strcmp(ext, "m4a") == 0) {
       if ((pid = vfork()) == 0) {
         execlp("ffmpeg", "ffmpeg", "-v", "quiet", "-y", "-i", params->input_path,
-               "-f", "wav", output_file, NULL);
+               "-f", "wav", "-rf64", "auto", output_file, NULL);
         _exit(1);
       }
       break;
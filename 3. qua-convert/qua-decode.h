@@ -5,6 +5,7 @@
 #include <linux/limits.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 // WAV audio properties
 typedef struct {
@@ -12,6 +13,8 @@ typedef struct {
   int sample_rate;
   int channels;
   bool is_float;  // true if IEEE 754 float format (audio_format == 3)
+  uint64_t data_bytes; // ds64 size for RF64/BW64
+  uint64_t frames;
 } wav_info_t;
 
 // Decode parameters structure
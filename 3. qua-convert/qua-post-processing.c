@@ -2,6 +2,7 @@
 
 /* Standard C Headers */
 #include <limits.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -79,6 +80,126 @@ int qua_post_process(const char *file_path, int bit_depth, int sample_rate,
   return 0;
 }
 
+// WAVE_FORMAT_EXTENSIBLE integer PCM header at h, returns its length (= data
+// offset). With rf64 set it is RF64 (EBU Tech 3306): a ds64 chunk ahead of
+// fmt holds the 64-bit RIFF size, data size and frame count, and the 32-bit
+// size fields read 0xFFFFFFFF. A data_offset past the natural length is
+// filled with a JUNK chunk (page-aligned data for the memfd handoff).
+#define WAV_EXT_HEADER_LEN 68
+#define WAV_EXT_RF64_HEADER_LEN 104
+
+static bool wav_needs_rf64(uint64_t data_len, size_t header_len) {
+  return data_len > UINT32_MAX - header_len;
+}
+
+static size_t wav_ext_header(uint8_t *h, uint16_t channels, uint32_t sample_rate,
+                             uint16_t bits, uint64_t data_len, bool rf64,
+                             size_t data_offset) {
+  size_t len = rf64 ? WAV_EXT_RF64_HEADER_LEN : WAV_EXT_HEADER_LEN;
+  uint8_t *f = h + 12;
+  uint16_t block_align = channels * (bits / 8);
+
+  if (data_offset < len)
+    data_offset = len;
+  memset(h, 0, data_offset);
+  memcpy(h + 8, "WAVE", 4);
+  if (rf64) {
+    uint64_t riff_size = data_offset - 8 + data_len;
+    uint64_t frames = data_len / block_align;
+    memcpy(h, "RF64", 4);
+    *(uint32_t *)(h + 4) = 0xFFFFFFFF;
+    memcpy(h + 12, "ds64", 4);
+    *(uint32_t *)(h + 16) = 28;
+    memcpy(h + 20, &riff_size, 8);
+    memcpy(h + 28, &data_len, 8);
+    memcpy(h + 36, &frames, 8);
+    f = h + 48; // table length at 44 stays 0
+  } else {
+    memcpy(h, "RIFF", 4);
+    *(uint32_t *)(h + 4) = (uint32_t)(data_offset - 8 + data_len);
+  }
+
+  memcpy(f, "fmt ", 4);
+  *(uint32_t *)(f + 4) = 40;
+  *(uint16_t *)(f + 8) = 0xFFFE;
+  *(uint16_t *)(f + 10) = channels;
+  *(uint32_t *)(f + 12) = sample_rate;
+  *(uint32_t *)(f + 16) = sample_rate * block_align;
+  *(uint16_t *)(f + 20) = block_align;
+  *(uint16_t *)(f + 22) = bits;
+  *(uint16_t *)(f + 24) = 22;
+  *(uint16_t *)(f + 26) = bits;
+  *(uint32_t *)(f + 28) = (channels == 2) ? 3 : 4;
+  uint8_t guid[16] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+                      0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+  memcpy(f + 32, guid, 16);
+  if (data_offset > len) {
+    memcpy(h + len - 8, "JUNK", 4);
+    *(uint32_t *)(h + len - 4) = (uint32_t)(data_offset - 8 - len);
+  }
+  memcpy(h + data_offset - 8, "data", 4);
+  *(uint32_t *)(h + data_offset - 4) = rf64 ? 0xFFFFFFFF : (uint32_t)data_len;
+  return data_offset;
+}
+
+// Output of the mmap converters: <input>.tmp, renamed over the input when
+// done, or the memfd given as out_fd (>= 0). A memfd is sized in whole pages
+// of its own page size (4K, or the huge page size for MFD_HUGETLB), carries
+// its data at a page offset so the player can map it in place, and is sealed
+// when done.
+typedef struct {
+  int fd;
+  uint8_t *map;
+  size_t map_len;
+  size_t header_len;
+  bool rf64;
+} wav_out_t;
+
+static size_t memfd_page_size(int fd) {
+  struct stat st;
+  return fstat(fd, &st) == 0 && st.st_blksize > 0 ? (size_t)st.st_blksize : 4096;
+}
+
+static int wav_out_open(wav_out_t *out, const char *tmp_path, int out_fd,
+                        uint64_t data_len) {
+  size_t page = out_fd >= 0 ? memfd_page_size(out_fd) : 0;
+  out->rf64 = wav_needs_rf64(data_len, page ? page : WAV_EXT_RF64_HEADER_LEN);
+  out->header_len = page ? page : (out->rf64 ? WAV_EXT_RF64_HEADER_LEN : WAV_EXT_HEADER_LEN);
+  out->map_len = out->header_len + data_len;
+  if (page)
+    out->map_len = (out->map_len + page - 1) / page * page;
+
+  out->fd = out_fd >= 0 ? out_fd : open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (out->fd == -1)
+    return -1;
+
+  // Allocate space in RAM for the output
+  if (ftruncate(out->fd, out->map_len) == 0) {
+    out->map = mmap(NULL, out->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, out->fd, 0);
+    if (out->map != MAP_FAILED)
+      return 0;
+  }
+  if (out_fd < 0) {
+    close(out->fd);
+    unlink(tmp_path);
+  }
+  return -1;
+}
+
+static int wav_out_finish(wav_out_t *out, int out_fd, const char *tmp_path,
+                          const char *input_path) {
+  munmap(out->map, out->map_len);
+  if (out_fd >= 0)
+    return memfd_seal(out_fd);
+  close(out->fd);
+  return rename(tmp_path, input_path);
+}
+
+int memfd_seal(int memfd) {
+  return fcntl(memfd, F_ADD_SEALS,
+               F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+}
+
 int convert_24bit_to_32bit_wav(const char *input_path) {
   char tmp_path[PATH_MAX];
   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", input_path);
@@ -98,16 +219,18 @@ int convert_24bit_to_32bit_wav(const char *input_path) {
   // Get parameters we need
   uint16_t channels = 0;
   uint32_t sample_rate = 0;
-  uint32_t data_size_24bit = 0;
 
   memcpy(&channels, header + 22, 2);
   memcpy(&sample_rate, header + 24, 4);
-  memcpy(&data_size_24bit, header + 40, 4);
 
-  // Calculate new sizes
-  uint32_t num_samples = data_size_24bit / 3;
-  uint32_t data_size_32bit = num_samples * 4;
-  uint32_t file_size_32bit = 36 + data_size_32bit;
+  // Data runs to EOF after the canonical 44-byte header; the 32-bit data
+  // size field cannot describe more than 4GB, the file size can
+  struct stat st;
+  if (fstat(fd_in, &st) != 0) {
+    close(fd_in);
+    return -1;
+  }
+  uint64_t data_size_32bit = (uint64_t)(st.st_size - 44) / 3 * 4;
 
   // Open output file
   int fd_out = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
@@ -116,19 +239,11 @@ int convert_24bit_to_32bit_wav(const char *input_path) {
     return -1;
   }
 
-  // Modify header for 32-bit
-  uint32_t byte_rate = sample_rate * channels * 4;
-  uint16_t block_align = channels * 4;
-  uint16_t bits_32 = 32;
-
-  memcpy(header + 4, &file_size_32bit, 4);
-  memcpy(header + 28, &byte_rate, 4);
-  memcpy(header + 32, &block_align, 2);
-  memcpy(header + 34, &bits_32, 2);
-  memcpy(header + 40, &data_size_32bit, 4);
-
-  // Write modified header
-  if (write(fd_out, header, 44) != 44) {
+  // Write 32-bit header (RF64 past 4GB)
+  uint8_t out_header[WAV_EXT_RF64_HEADER_LEN];
+  size_t header_len = wav_ext_header(out_header, channels, sample_rate, 32, data_size_32bit,
+                                     wav_needs_rf64(data_size_32bit, WAV_EXT_RF64_HEADER_LEN), 0);
+  if (write(fd_out, out_header, header_len) != (ssize_t)header_len) {
     close(fd_in);
     close(fd_out);
     unlink(tmp_path);
@@ -212,25 +327,18 @@ int convert_24bit_to_32bit_wav_fast(const char *input_path) {
     return -1;
   }
 
-  uint8_t h[68] = {0};
-  memcpy(h, "RIFF", 4);
-  memcpy(h + 8, "WAVE", 4);
-  memcpy(h + 12, "fmt ", 4);
-  *(uint32_t *)(h + 16) = 40;
-  *(uint16_t *)(h + 20) = 0xFFFE;
-  *(uint16_t *)(h + 22) = channels;
-  *(uint32_t *)(h + 24) = sample_rate;
-  *(uint32_t *)(h + 28) = sample_rate * channels * 4;
-  *(uint16_t *)(h + 32) = channels * 4;
-  *(uint16_t *)(h + 34) = 32;
-  *(uint16_t *)(h + 36) = 22;
-  *(uint16_t *)(h + 38) = 32;
-  *(uint32_t *)(h + 40) = (channels == 2) ? 3 : 4;
-  uint8_t guid[16] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
-                      0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
-  memcpy(h + 44, guid, 16);
-  memcpy(h + 60, "data", 4);
-  write(fd_out, h, 68);
+  // Output size is known up front from the input, so the header format
+  // (RIFF or RF64) is fixed now and only its sizes are patched at the end
+  struct stat st;
+  off_t data_pos = lseek(fd_in, 0, SEEK_CUR);
+  uint64_t est_len = 0;
+  if (fstat(fd_in, &st) == 0 && st.st_size > data_pos)
+    est_len = (uint64_t)(st.st_size - data_pos) / 3 * 4;
+  bool rf64 = wav_needs_rf64(est_len, WAV_EXT_RF64_HEADER_LEN);
+
+  uint8_t h[WAV_EXT_RF64_HEADER_LEN];
+  size_t header_len = wav_ext_header(h, channels, sample_rate, 32, 0, rf64, 0);
+  write(fd_out, h, header_len);
 
   const size_t batch = 65536;
   uint8_t *in = _mm_malloc(batch * 3, 32);
@@ -266,13 +374,9 @@ int convert_24bit_to_32bit_wav_fast(const char *input_path) {
       lseek(fd_in, -(n % 3), SEEK_CUR);
   }
 
-  uint32_t final = lseek(fd_out, 0, SEEK_CUR);
-  lseek(fd_out, 4, SEEK_SET);
-  uint32_t r_sz = final - 8;
-  write(fd_out, &r_sz, 4);
-  lseek(fd_out, 64, SEEK_SET);
-  uint32_t d_sz = final - 68;
-  write(fd_out, &d_sz, 4);
+  off_t final = lseek(fd_out, 0, SEEK_CUR);
+  wav_ext_header(h, channels, sample_rate, 32, (uint64_t)final - header_len, rf64, 0);
+  pwrite(fd_out, h, header_len, 0);
 
   _mm_free(in);
   _mm_free(out);
@@ -283,7 +387,7 @@ int convert_24bit_to_32bit_wav_fast(const char *input_path) {
 }
 
 // AVX2: High-performance 16-bit to 32-bit PCM conversion
-int convert_16bit_to_32bit_wav_fast(const char *input_path) {
+int convert_16bit_to_32bit_wav_fast(const char *input_path, int out_fd) {
   char tmp_path[PATH_MAX];
   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", input_path);
 
@@ -327,60 +431,25 @@ int convert_16bit_to_32bit_wav_fast(const char *input_path) {
     return -1;
   }
 
-  // 2. Prepare Output in /dev/shm
+  // 2. Prepare Output in /dev/shm (or the memfd)
   size_t total_samples = (file_size - data_offset) / 2;
   size_t output_data_len = total_samples * 4;
-  size_t total_out_size = 68 + output_data_len;
-
-  int fd_out = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
-  if (fd_out == -1) {
-    munmap(src, file_size);
-    close(fd_in);
-    return -1;
-  }
-
-  // Allocate space in RAM for the output
-  if (ftruncate(fd_out, total_out_size) != 0) {
-    munmap(src, file_size);
-    close(fd_in);
-    close(fd_out);
-    return -1;
-  }
 
   // 3. Map Output (CPU-to-RAM path)
-  uint8_t *dst =
-      mmap(NULL, total_out_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_out, 0);
-  if (dst == MAP_FAILED) {
+  wav_out_t out;
+  if (wav_out_open(&out, tmp_path, out_fd, output_data_len) != 0) {
     munmap(src, file_size);
     close(fd_in);
-    close(fd_out);
     return -1;
   }
+  uint8_t *dst = out.map;
 
   // Write WaveFormatExtensible Header directly to memory
-  memcpy(dst, "RIFF", 4);
-  memcpy(dst + 8, "WAVE", 4);
-  memcpy(dst + 12, "fmt ", 4);
-  *(uint32_t *)(dst + 4) = (uint32_t)(total_out_size - 8);
-  *(uint32_t *)(dst + 16) = 40;
-  *(uint16_t *)(dst + 20) = 0xFFFE;
-  *(uint16_t *)(dst + 22) = channels;
-  *(uint32_t *)(dst + 24) = sample_rate;
-  *(uint32_t *)(dst + 28) = sample_rate * channels * 4;
-  *(uint16_t *)(dst + 32) = (uint16_t)(channels * 4);
-  *(uint16_t *)(dst + 34) = 32;
-  *(uint16_t *)(dst + 36) = 22;
-  *(uint16_t *)(dst + 38) = 32;
-  *(uint32_t *)(dst + 40) = (channels == 2) ? 3 : 4;
-  uint8_t guid[16] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
-                      0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
-  memcpy(dst + 44, guid, 16);
-  memcpy(dst + 60, "data", 4);
-  *(uint32_t *)(dst + 64) = (uint32_t)output_data_len;
+  wav_ext_header(dst, channels, sample_rate, 32, output_data_len, out.rf64, out.header_len);
 
   // 4. SIMD "Memory-to-Memory" Burst
   int16_t *in_ptr = (int16_t *)(src + data_offset);
-  int32_t *out_ptr = (int32_t *)(dst + 68);
+  int32_t *out_ptr = (int32_t *)(dst + out.header_len);
   size_t i = 0;
 
   // Unrolled 32-sample burst (128 bytes in -> 256 bytes out)
@@ -409,16 +478,13 @@ int convert_16bit_to_32bit_wav_fast(const char *input_path) {
     out_ptr[i] = (int32_t)in_ptr[i] << 16;
   }
 
-  // Clean up and Atomic swap
+  // Clean up and Atomic swap (or seal)
   munmap(src, file_size);
-  munmap(dst, total_out_size);
   close(fd_in);
-  close(fd_out);
-  rename(tmp_path, input_path);
-  return 0;
+  return wav_out_finish(&out, out_fd, tmp_path, input_path) == 0 ? 0 : -1;
 }
 
-int convert_24bit_to_32bit_wav_ultrafast(const char *input_path) {
+int convert_24bit_to_32bit_wav_ultrafast(const char *input_path, int out_fd) {
     char tmp_path[PATH_MAX];
     snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", input_path);
 
@@ -460,48 +526,21 @@ int convert_24bit_to_32bit_wav_ultrafast(const char *input_path) {
 
     size_t total_samples = (file_size - data_offset) / 3;
     size_t output_data_len = total_samples * 4;
-    size_t total_out_size = 68 + output_data_len;
-
-    int fd_out = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
-    if (fd_out == -1) {
-        munmap(src, file_size);
-        close(fd_in);
-        return -1;
-    }
-    ftruncate(fd_out, total_out_size);
 
-    // Map output file directly back to /dev/shm
-    uint8_t *dst = mmap(NULL, total_out_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_out, 0);
-    if (dst == MAP_FAILED) {
+    // Map output file directly back to /dev/shm (or the memfd)
+    wav_out_t out;
+    if (wav_out_open(&out, tmp_path, out_fd, output_data_len) != 0) {
         munmap(src, file_size);
         close(fd_in);
-        close(fd_out);
         return -1;
     }
+    uint8_t *dst = out.map;
 
-    // Header logic (Standard RIFF/WAVE 32-bit PCM)
-    memcpy(dst, "RIFF", 4);
-    memcpy(dst + 8, "WAVE", 4);
-    memcpy(dst + 12, "fmt ", 4);
-    *(uint32_t *)(dst + 4) = (uint32_t)(total_out_size - 8);
-    *(uint32_t *)(dst + 16) = 40;
-    *(uint16_t *)(dst + 20) = 0xFFFE;
-    *(uint16_t *)(dst + 22) = channels;
-    *(uint32_t *)(dst + 24) = sample_rate;
-    *(uint32_t *)(dst + 28) = sample_rate * channels * 4;
-    *(uint16_t *)(dst + 32) = (uint16_t)(channels * 4);
-    *(uint16_t *)(dst + 34) = 32;
-    *(uint16_t *)(dst + 36) = 22;
-    *(uint16_t *)(dst + 38) = 32;
-    *(uint32_t *)(dst + 40) = (channels == 2) ? 3 : 4;
-    uint8_t guid[16] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
-                        0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
-    memcpy(dst + 44, guid, 16);
-    memcpy(dst + 60, "data", 4);
-    *(uint32_t *)(dst + 64) = (uint32_t)output_data_len;
+    // Header logic (RIFF/WAVE 32-bit PCM, RF64 past 4GB)
+    wav_ext_header(dst, channels, sample_rate, 32, output_data_len, out.rf64, out.header_len);
 
     uint8_t *in_ptr = src + data_offset;
-    uint8_t *out_ptr = dst + 68;
+    uint8_t *out_ptr = dst + out.header_len;
 
     // Mask to convert 3-byte samples to 4-byte lanes (Zero-pad LSB)
     __m128i mask = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
@@ -533,9 +572,63 @@ int convert_24bit_to_32bit_wav_ultrafast(const char *input_path) {
     }
 
     munmap(src, file_size);
-    munmap(dst, total_out_size);
     close(fd_in);
-    close(fd_out);
-    rename(tmp_path, input_path);
-    return 0;
-}
\ No newline at end of file
+    return wav_out_finish(&out, out_fd, tmp_path, input_path) == 0 ? 0 : -1;
+}
+// Copy a finished integer PCM WAV into the memfd with a page-aligned data
+// offset, for outputs no converter wrote there directly
+int wav_to_memfd(const char *input_path, int out_fd) {
+    int fd_in = open(input_path, O_RDONLY);
+    if (fd_in == -1) return -1;
+
+    struct stat st;
+    if (fstat(fd_in, &st) != 0) {
+        close(fd_in);
+        return -1;
+    }
+    size_t file_size = st.st_size;
+
+    uint8_t *src = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd_in, 0);
+    if (src == MAP_FAILED) {
+        close(fd_in);
+        return -1;
+    }
+
+    uint16_t channels = 0;
+    uint32_t sample_rate = 0;
+    uint16_t bits = 0;
+    uint32_t data_offset = 0;
+    for (uint32_t i = 12; i < 1024 && i < file_size - 8;) {
+        if (memcmp(src + i, "fmt ", 4) == 0) {
+            channels = *(uint16_t *)(src + i + 10);
+            sample_rate = *(uint32_t *)(src + i + 12);
+            bits = *(uint16_t *)(src + i + 22);
+            i += 8 + *(uint32_t *)(src + i + 4);
+        } else if (memcmp(src + i, "data", 4) == 0) {
+            data_offset = i + 8;
+            break;
+        } else {
+            i += 8 + *(uint32_t *)(src + i + 4);
+        }
+    }
+
+    if (channels == 0 || bits < 8 || data_offset == 0) {
+        munmap(src, file_size);
+        close(fd_in);
+        return -1;
+    }
+
+    size_t data_len = file_size - data_offset;
+    wav_out_t out;
+    if (wav_out_open(&out, NULL, out_fd, data_len) != 0) {
+        munmap(src, file_size);
+        close(fd_in);
+        return -1;
+    }
+    wav_ext_header(out.map, channels, sample_rate, bits, data_len, out.rf64, out.header_len);
+    memcpy(out.map + out.header_len, src + data_offset, data_len);
+
+    munmap(src, file_size);
+    close(fd_in);
+    return wav_out_finish(&out, out_fd, NULL, NULL) == 0 ? 0 : -1;
+}
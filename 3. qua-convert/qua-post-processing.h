@@ -12,7 +12,17 @@
 int qua_post_process(const char *input_path, int bit_depth, int sample_rate, int channels);
 int convert_24bit_to_32bit_wav(const char *input_path);
 int convert_24bit_to_32bit_wav_fast(const char *input_path);
-int convert_24bit_to_32bit_wav_ultrafast(const char *input_path);
-int convert_16bit_to_32bit_wav_fast(const char *input_path);
+
+// out_fd: -1 = rewrite input_path in place (via .tmp), otherwise a memfd
+// (MFD_ALLOW_SEALING) that receives the output with its data at a page
+// offset and is sealed on success
+int convert_24bit_to_32bit_wav_ultrafast(const char *input_path, int out_fd);
+int convert_16bit_to_32bit_wav_fast(const char *input_path, int out_fd);
+
+// Copy an integer PCM WAV into out_fd as above, sealing it
+int wav_to_memfd(const char *input_path, int out_fd);
+
+// Seal a memfd against any further change (the player maps it read-only)
+int memfd_seal(int memfd);
 
 #endif
@@ -3,17 +3,54 @@
 #include <X11/XF86keysym.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <stdint.h>
 #include <string.h>
 #include <unistd.h>
+#include "qua-proto.h"  // the daemon's, via -I in the Makefile
 
+// Protocol v2: one connection for every key instead of a connect per
+// press. Replies are drained and ignored; a daemon restart is noticed on
+// the next key, which reconnects.
 
-static void send_cmd(const char *cmd) {
-    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+static int sock = -1;
+static uint32_t next_id;
+
+static int connect_daemon(void) {
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
     struct sockaddr_un addr = { .sun_family = AF_UNIX };
     strcpy(addr.sun_path, "/tmp/qua-socket.sock");
-    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0)
-        write(fd, cmd, strlen(cmd) + 1);
-    close(fd);
+    if (sock == -1 || connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        send(sock, QUA_PROTO_MAGIC, QUA_PROTO_MAGIC_LEN, MSG_NOSIGNAL) != QUA_PROTO_MAGIC_LEN) {
+        if (sock != -1) close(sock);
+        sock = -1;
+    }
+    return sock;
+}
+
+static int send_frame(const char *cmd) {
+    char drain[4096];
+    ssize_t n;
+    while ((n = recv(sock, drain, sizeof(drain), MSG_DONTWAIT)) > 0)
+        ;
+    if (n == 0)
+        return -1;  // daemon went away
+    struct {
+        struct qua_frame f;
+        char payload[32];
+    } msg = { .f = { .len = strlen(cmd) + 1, .id = ++next_id, .type = QUA_REQUEST } };
+    memcpy(msg.payload, cmd, msg.f.len);
+    size_t len = sizeof(msg.f) + msg.f.len;
+    return send(sock, &msg, len, MSG_NOSIGNAL) == (ssize_t)len ? 0 : -1;
+}
+
+static void send_cmd(const char *cmd) {
+    if (sock != -1 && send_frame(cmd) == 0)
+        return;
+    if (sock != -1) close(sock);
+    if (connect_daemon() != -1 && send_frame(cmd) != 0) {
+        close(sock);
+        sock = -1;
+    }
 }
 
 int main(void) {